@@ -0,0 +1,95 @@
+#include <algorithm>
+#include <chrono>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "Benchmark.hpp"
+
+std::vector<BenchmarkResult> Benchmark::m_Results;
+
+void LatencySamples::Append(const LatencySamples& other) {
+	m_Samples.insert(m_Samples.end(), other.m_Samples.begin(), other.m_Samples.end());
+}
+
+double LatencySamples::Percentile(double fraction) {
+	if (m_Samples.empty()) {
+		return 0.0;
+	}
+	size_t index = (size_t)(fraction * (double)(m_Samples.size() - 1));
+	std::nth_element(m_Samples.begin(), m_Samples.begin() + index, m_Samples.end());
+	return (double)m_Samples[index];
+}
+
+unsigned long long Benchmark::Now() {
+	return (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+unsigned long long Benchmark::GetPeakRss() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters{};
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+		return 0;
+	}
+	return counters.PeakWorkingSetSize;
+#else
+	struct rusage usage{};
+	getrusage(RUSAGE_SELF, &usage);
+	// ru_maxrss is reported in kilobytes
+	return (unsigned long long)usage.ru_maxrss * 1024;
+#endif
+}
+
+void Benchmark::Report(const BenchmarkResult& result) {
+	m_Results.push_back(result);
+	// Progress goes to stderr so stdout stays valid JSON
+	fprintf(stderr, "%-22s %-26s threads %u: %8.2f ns/op, p99 %8.0f ns",
+		result.s_Name,
+		result.s_Variant,
+		result.s_Threads,
+		result.s_NsPerOp,
+		result.s_P99Ns);
+	if (result.s_Bytes > 0) {
+		fprintf(stderr, ", %llu bytes, %.2f GB/s", result.s_Bytes, (double)result.s_Bytes / result.s_NsPerOp);
+	}
+	if (result.s_Items > 0) {
+		fprintf(stderr, ", %llu items", result.s_Items);
+	}
+	fprintf(stderr, "\n");
+}
+
+void Benchmark::WriteJson(FILE* file) {
+	fprintf(file, "{\n\t\"benchmarks\": [\n");
+	for (size_t i = 0; i < m_Results.size(); i++) {
+		const BenchmarkResult& result = m_Results[i];
+		fprintf(file, "\t\t{ \"name\": \"%s\", \"variant\": \"%s\", \"threads\": %u, \"operations\": %llu, ",
+			result.s_Name,
+			result.s_Variant,
+			result.s_Threads,
+			result.s_Operations);
+		if (result.s_Bytes > 0) {
+			fprintf(file, "\"bytes\": %llu, \"gb_per_s\": %.3f, ", result.s_Bytes, (double)result.s_Bytes / result.s_NsPerOp);
+		}
+		if (result.s_Items > 0) {
+			fprintf(file, "\"items\": %llu, ", result.s_Items);
+		}
+		fprintf(file, "\"ns_per_op\": %.3f, \"p50_ns\": %.0f, \"p99_ns\": %.0f, \"peak_rss_bytes\": %llu, \"fragmentation\": ",
+			result.s_NsPerOp,
+			result.s_P50Ns,
+			result.s_P99Ns,
+			result.s_PeakRss);
+		if (result.s_Fragmentation < 0.0f) {
+			fprintf(file, "null }");
+		}
+		else {
+			fprintf(file, "%.4f }", result.s_Fragmentation);
+		}
+		fprintf(file, i + 1 < m_Results.size() ? ",\n" : "\n");
+	}
+	fprintf(file, "\t]\n}\n");
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <stdio.h>
+#include <vector>
+
+// Fragmentation value for allocators that cannot report it, written as null
+#define BENCHMARK_NO_FRAGMENTATION -1.0f
+
+struct BenchmarkResult {
+	const char* s_Name;
+	// Allocator or kernel that was measured
+	const char* s_Variant;
+	unsigned int s_Threads;
+	unsigned long long s_Operations;
+	// Bytes processed by one operation, 0 if it does not apply
+	unsigned long long s_Bytes;
+	// Elements one operation works on, like listeners per event, 0 if it does not apply
+	unsigned long long s_Items;
+	// Average cost of one operation on one thread
+	double s_NsPerOp;
+	double s_P50Ns;
+	double s_P99Ns;
+	// Process wide peak resident set size after the case ran
+	unsigned long long s_PeakRss;
+	float s_Fragmentation;
+};
+
+// Timings of single operations, collected in a separate pass so the
+// throughput numbers do not include the cost of reading the clock
+class LatencySamples {
+public:
+	void Reserve(size_t count) { m_Samples.reserve(count); }
+	void Record(unsigned long long ns) { m_Samples.push_back(ns); }
+	void Append(const LatencySamples& other);
+	void Clear() { m_Samples.clear(); }
+
+	// fraction in [0, 1]
+	double Percentile(double fraction);
+private:
+	std::vector<unsigned long long> m_Samples;
+};
+
+// xorshift64, every allocator in a case is driven by the same sequence
+class BenchmarkRandom {
+public:
+	BenchmarkRandom(unsigned long long seed) : m_State(seed) {}
+
+	unsigned int Next() {
+		m_State ^= m_State << 13;
+		m_State ^= m_State >> 7;
+		m_State ^= m_State << 17;
+		return (unsigned int)(m_State >> 32);
+	}
+
+	// Sizes between min and max with every power of two range equally likely,
+	// so small blocks dominate by count and large blocks by bytes
+	unsigned int NextSize(unsigned int minLog2, unsigned int maxLog2) {
+		unsigned int base = 1u << (minLog2 + Next() % (maxLog2 - minLog2));
+		return base + Next() % base;
+	}
+private:
+	unsigned long long m_State;
+};
+
+class Benchmark {
+public:
+	// Monotonic time in nanoseconds
+	static unsigned long long Now();
+	static unsigned long long GetPeakRss();
+
+	static void Report(const BenchmarkResult& result);
+	static void WriteJson(FILE* file);
+private:
+	static std::vector<BenchmarkResult> m_Results;
+};
+
+// Suites, every suite reports its results through Benchmark::Report
+void RunMemoryBenchmarks(unsigned int scale);
+void RunCopyBenchmarks(unsigned int scale);
+void RunEventBenchmarks(unsigned int scale);
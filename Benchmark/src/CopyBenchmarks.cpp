@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Benchmark.hpp"
+#include "core/Memory.hpp"
+#include "core/MemoryKernels.hpp"
+
+#define COPY_BENCHMARK_MIN_SIZE (4ULL * 1024)
+#define COPY_BENCHMARK_MAX_SIZE (256ULL * 1024 * 1024)
+// Bytes moved per size and variant at scale 1
+#define COPY_BENCHMARK_BYTES_PER_SCALE (64ULL * 1024 * 1024)
+
+typedef void (*CopyFunction)(void* dest, const void* src, unsigned long long size);
+
+struct CopyVariant {
+	const char* s_Name;
+	CopyFunction s_Function;
+};
+
+static void libcCopy(void* dest, const void* src, unsigned long long size) { memcpy(dest, src, (size_t)size); }
+static void memoryCopy(void* dest, const void* src, unsigned long long size) { Memory::Copy(dest, src, size); }
+static void streamCopy(void* dest, const void* src, unsigned long long size) { MemoryKernels::StreamCopy(dest, src, size); }
+
+// Fills ignore src, so they can share the copy harness
+static void libcFill(void* dest, const void* src, unsigned long long size) { memset(dest, 0x5A, (size_t)size); }
+static void memoryFill(void* dest, const void* src, unsigned long long size) { Memory::Set(dest, 0x5A, size); }
+static void streamFill(void* dest, const void* src, unsigned long long size) { MemoryKernels::StreamFill(dest, 0x5A, size); }
+
+static void runVariant(const char* name, const CopyVariant& variant, char* dest, const char* src, unsigned long long size, unsigned int scale) {
+	unsigned long long iterations = COPY_BENCHMARK_BYTES_PER_SCALE * scale / size;
+	if (iterations == 0) {
+		iterations = 1;
+	}
+
+	// Warm up, then one untimed pass for throughput and one pass that times every call
+	variant.s_Function(dest, src, size);
+
+	unsigned long long start = Benchmark::Now();
+	for (unsigned long long i = 0; i < iterations; i++) {
+		variant.s_Function(dest, src, size);
+	}
+	unsigned long long elapsed = Benchmark::Now() - start;
+
+	LatencySamples samples;
+	samples.Reserve((size_t)iterations);
+	for (unsigned long long i = 0; i < iterations; i++) {
+		unsigned long long callStart = Benchmark::Now();
+		variant.s_Function(dest, src, size);
+		samples.Record(Benchmark::Now() - callStart);
+	}
+
+	BenchmarkResult result{};
+	result.s_Name = name;
+	result.s_Variant = variant.s_Name;
+	result.s_Threads = 1;
+	result.s_Operations = iterations;
+	result.s_Bytes = size;
+	result.s_NsPerOp = (double)elapsed / (double)iterations;
+	result.s_P50Ns = samples.Percentile(0.50);
+	result.s_P99Ns = samples.Percentile(0.99);
+	result.s_PeakRss = Benchmark::GetPeakRss();
+	result.s_Fragmentation = BENCHMARK_NO_FRAGMENTATION;
+	Benchmark::Report(result);
+}
+
+void RunCopyBenchmarks(unsigned int scale) {
+	// Buffers come from the system heap so the engine heap size does not limit the sizes
+	char* src = (char*)malloc((size_t)COPY_BENCHMARK_MAX_SIZE);
+	char* dest = (char*)malloc((size_t)COPY_BENCHMARK_MAX_SIZE);
+	if (!src || !dest) {
+		fprintf(stderr, "Cannot allocate the copy benchmark buffers.\n");
+		free(src);
+		free(dest);
+		return;
+	}
+	// Fault every page in up front so no pass pays for it
+	memset(src, 0x3C, (size_t)COPY_BENCHMARK_MAX_SIZE);
+	memset(dest, 0, (size_t)COPY_BENCHMARK_MAX_SIZE);
+
+	static char streamCopyName[64];
+	static char streamFillName[64];
+	snprintf(streamCopyName, sizeof(streamCopyName), "StreamCopy/%s", MemoryKernels::GetKernelName());
+	snprintf(streamFillName, sizeof(streamFillName), "StreamFill/%s", MemoryKernels::GetKernelName());
+
+	CopyVariant copies[] = {
+		{ "memcpy", libcCopy },
+		{ "Memory::Copy", memoryCopy },
+		{ streamCopyName, streamCopy }
+	};
+	CopyVariant fills[] = {
+		{ "memset", libcFill },
+		{ "Memory::Set", memoryFill },
+		{ streamFillName, streamFill }
+	};
+
+	for (unsigned long long size = COPY_BENCHMARK_MIN_SIZE; size <= COPY_BENCHMARK_MAX_SIZE; size *= 4) {
+		for (const CopyVariant& variant : copies) {
+			runVariant("bulk_copy", variant, dest, src, size, scale);
+		}
+		for (const CopyVariant& variant : fills) {
+			runVariant("bulk_fill", variant, dest, src, size, scale);
+		}
+	}
+
+	free(src);
+	free(dest);
+}
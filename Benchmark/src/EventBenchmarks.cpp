@@ -0,0 +1,233 @@
+#include <functional>
+
+#include "Benchmark.hpp"
+#include "core/Event.hpp"
+#include "core/EventChannel.hpp"
+
+#define EVENT_BENCHMARK_FIRES_PER_SCALE 200000
+
+// Listeners do a little work so the calls cannot be folded away
+static volatile unsigned int eventSink;
+
+static bool onEvent(const void* sender, EventContext context, EventType type) {
+	eventSink = eventSink + context.u32[0];
+	return true;
+}
+
+static void runDispatch(const char* name, unsigned int listeners, unsigned int unrelated, unsigned int scale) {
+	EventSystem::Initialize();
+	for (unsigned int i = 0; i < listeners; i++) {
+		EventSystem::RegisterEvent(nullptr, EVENT_TYPE_MOUSE_MOVED, onEvent);
+	}
+	// Spread the rest over every other type, a scan over all listeners would pay for them
+	for (unsigned int i = 0; i < unrelated; i++) {
+		EventType type = (EventType)(EVENT_TYPE_MOUSE_CLICKED + i % (EVENT_TYPE_MAX - 1));
+		EventSystem::RegisterEvent(nullptr, type, onEvent);
+	}
+
+	EventContext context{};
+	context.u32[0] = 1;
+	unsigned long long fires = (unsigned long long)EVENT_BENCHMARK_FIRES_PER_SCALE * scale / listeners;
+	if (fires == 0) {
+		fires = 1;
+	}
+
+	// Warm up, then one untimed pass for throughput and one pass that times every call
+	for (unsigned long long i = 0; i < fires / 10 + 1; i++) {
+		EventSystem::FireEvent(nullptr, context, EVENT_TYPE_MOUSE_MOVED);
+	}
+
+	unsigned long long start = Benchmark::Now();
+	for (unsigned long long i = 0; i < fires; i++) {
+		EventSystem::FireEvent(nullptr, context, EVENT_TYPE_MOUSE_MOVED);
+	}
+	unsigned long long elapsed = Benchmark::Now() - start;
+
+	LatencySamples samples;
+	samples.Reserve((size_t)fires);
+	for (unsigned long long i = 0; i < fires; i++) {
+		unsigned long long callStart = Benchmark::Now();
+		EventSystem::FireEvent(nullptr, context, EVENT_TYPE_MOUSE_MOVED);
+		samples.Record(Benchmark::Now() - callStart);
+	}
+	EventSystem::Shutdown();
+
+	BenchmarkResult result{};
+	result.s_Name = name;
+	result.s_Variant = "EventSystem";
+	result.s_Threads = 1;
+	// Operations are fired events, items the listeners each of them reaches
+	result.s_Operations = fires;
+	result.s_Items = listeners;
+	result.s_NsPerOp = (double)elapsed / (double)fires;
+	result.s_P50Ns = samples.Percentile(0.50);
+	result.s_P99Ns = samples.Percentile(0.99);
+	result.s_PeakRss = Benchmark::GetPeakRss();
+	result.s_Fragmentation = BENCHMARK_NO_FRAGMENTATION;
+	Benchmark::Report(result);
+}
+
+// Four listeners on a resize, through each of the three dispatch paths
+static void onResize(const WindowResizeEvent& event) {
+	eventSink = eventSink + event.s_Width;
+}
+
+static bool onResizeListener(const WindowResizeEvent& event) {
+	onResize(event);
+	return true;
+}
+
+static bool onResizeContext(const void* sender, EventContext context, EventType type) {
+	onResize(WindowResizeEvent::FromContext(context));
+	return true;
+}
+
+template<typename Fire>
+static void runTyped(const char* variant, Fire fire, unsigned int scale) {
+	WindowResizeEvent event{ 1920, 1080 };
+	unsigned long long fires = (unsigned long long)EVENT_BENCHMARK_FIRES_PER_SCALE * 10 * scale;
+	for (unsigned long long i = 0; i < fires / 10; i++) {
+		fire(event);
+	}
+
+	unsigned long long start = Benchmark::Now();
+	for (unsigned long long i = 0; i < fires; i++) {
+		fire(event);
+	}
+	unsigned long long elapsed = Benchmark::Now() - start;
+
+	BenchmarkResult result{};
+	result.s_Name = "event_typed_dispatch";
+	result.s_Variant = variant;
+	result.s_Threads = 1;
+	result.s_Operations = fires;
+	result.s_Items = 4;
+	result.s_NsPerOp = (double)elapsed / (double)fires;
+	result.s_P50Ns = result.s_NsPerOp;
+	result.s_P99Ns = result.s_NsPerOp;
+	result.s_PeakRss = Benchmark::GetPeakRss();
+	result.s_Fragmentation = BENCHMARK_NO_FRAGMENTATION;
+	Benchmark::Report(result);
+}
+
+static void runTypedDispatch(unsigned int scale) {
+	runTyped("EventDispatcher", [](const WindowResizeEvent& event) {
+		EventDispatcher<WindowResizeEvent, onResize, onResize, onResize, onResize>::Fire(event);
+	}, scale);
+
+	for (unsigned int i = 0; i < 4; i++) {
+		EventChannel<WindowResizeEvent>::Subscribe(onResizeListener);
+	}
+	runTyped("EventChannel", [](const WindowResizeEvent& event) {
+		EventChannel<WindowResizeEvent>::Fire(event);
+	}, scale);
+	EventChannel<WindowResizeEvent>::Clear();
+
+	EventSystem::Initialize();
+	for (unsigned int i = 0; i < 4; i++) {
+		EventSystem::RegisterEvent(nullptr, EVENT_TYPE_WINDOW_RESIZE, onResizeContext);
+	}
+	runTyped("EventSystem", [](const WindowResizeEvent& event) {
+		EventContext context{};
+		context.u32[0] = event.s_Width;
+		context.u32[1] = event.s_Height;
+		EventSystem::FireEvent(nullptr, context, EVENT_TYPE_WINDOW_RESIZE);
+	}, scale);
+	EventSystem::Shutdown();
+}
+
+// Cost of one call through the wrapper with a capture like the Application handlers have
+template<typename Callback>
+static void runCall(const char* variant, unsigned int scale) {
+	unsigned int counter = 0;
+	Callback callback = [&counter](const void* sender, EventContext context, EventType type) {
+		counter += context.u32[0];
+		return true;
+	};
+	// Calls go through a volatile pointer so the compiler cannot see the target
+	Callback* volatile target = &callback;
+
+	EventContext context{};
+	context.u32[0] = 1;
+	unsigned long long calls = (unsigned long long)EVENT_BENCHMARK_FIRES_PER_SCALE * 10 * scale;
+	for (unsigned long long i = 0; i < calls / 10; i++) {
+		(*target)(nullptr, context, EVENT_TYPE_MOUSE_MOVED);
+	}
+
+	unsigned long long start = Benchmark::Now();
+	for (unsigned long long i = 0; i < calls; i++) {
+		(*target)(nullptr, context, EVENT_TYPE_MOUSE_MOVED);
+	}
+	unsigned long long elapsed = Benchmark::Now() - start;
+	eventSink = counter;
+
+	// Single calls are far below the clock resolution, so there are no percentiles
+	BenchmarkResult result{};
+	result.s_Name = "event_callback_call";
+	result.s_Variant = variant;
+	result.s_Threads = 1;
+	result.s_Operations = calls;
+	result.s_NsPerOp = (double)elapsed / (double)calls;
+	result.s_P50Ns = result.s_NsPerOp;
+	result.s_P99Ns = result.s_NsPerOp;
+	result.s_PeakRss = Benchmark::GetPeakRss();
+	result.s_Fragmentation = BENCHMARK_NO_FRAGMENTATION;
+	Benchmark::Report(result);
+}
+
+// A short lived system subscribing and unsubscribing while others stay registered
+static void runSubscribeChurn(unsigned int listeners, unsigned int scale) {
+	EventSystem::Initialize();
+	for (unsigned int i = 0; i < listeners; i++) {
+		EventSystem::RegisterEvent(nullptr, EVENT_TYPE_MOUSE_MOVED, onEvent);
+	}
+
+	unsigned long long pairs = (unsigned long long)EVENT_BENCHMARK_FIRES_PER_SCALE * scale;
+	for (unsigned long long i = 0; i < pairs / 10; i++) {
+		EventSystem::UnregisterEvent(EventSystem::RegisterEvent(nullptr, EVENT_TYPE_MOUSE_MOVED, onEvent));
+	}
+
+	unsigned long long start = Benchmark::Now();
+	for (unsigned long long i = 0; i < pairs; i++) {
+		EventSystem::UnregisterEvent(EventSystem::RegisterEvent(nullptr, EVENT_TYPE_MOUSE_MOVED, onEvent));
+	}
+	unsigned long long elapsed = Benchmark::Now() - start;
+
+	LatencySamples samples;
+	samples.Reserve((size_t)pairs);
+	for (unsigned long long i = 0; i < pairs; i++) {
+		unsigned long long callStart = Benchmark::Now();
+		EventSystem::UnregisterEvent(EventSystem::RegisterEvent(nullptr, EVENT_TYPE_MOUSE_MOVED, onEvent));
+		samples.Record(Benchmark::Now() - callStart);
+	}
+	EventSystem::Shutdown();
+
+	// One operation is a register and unregister pair
+	BenchmarkResult result{};
+	result.s_Name = "event_subscribe_churn";
+	result.s_Variant = "EventSystem";
+	result.s_Threads = 1;
+	result.s_Operations = pairs;
+	result.s_Items = listeners;
+	result.s_NsPerOp = (double)elapsed / (double)pairs;
+	result.s_P50Ns = samples.Percentile(0.50);
+	result.s_P99Ns = samples.Percentile(0.99);
+	result.s_PeakRss = Benchmark::GetPeakRss();
+	result.s_Fragmentation = BENCHMARK_NO_FRAGMENTATION;
+	Benchmark::Report(result);
+}
+
+void RunEventBenchmarks(unsigned int scale) {
+	runCall<std::function<bool(const void*, EventContext, EventType)>>("std::function", scale);
+	runCall<pfnOnEvent>("Delegate", scale);
+	runTypedDispatch(scale);
+
+	for (unsigned int listeners = 1; listeners <= MAX_REGISTERED_EVENT_CALLBACKS; listeners *= 2) {
+		runDispatch("event_dispatch", listeners, 0, scale);
+	}
+	// One listener for the fired type and the rest of the slots taken by others
+	runDispatch("event_dispatch_others", 1, MAX_REGISTERED_EVENT_CALLBACKS - 1, scale);
+
+	runSubscribeChurn(1, scale);
+	runSubscribeChurn(MAX_REGISTERED_EVENT_CALLBACKS - 1, scale);
+}
@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Benchmark.hpp"
+#include "core/Logger.hpp"
+#include "core/Memory.hpp"
+
+// Usage: Benchmark [--quick] [--scale N] [--suite memory|copy|event] [--pages default|thp|huge] [--out file.json]
+// Runs every suite unless --suite is given. Results are written as JSON to stdout unless --out is given.
+int main(int argc, char** argv) {
+	unsigned int scale = 10;
+	const char* outPath = nullptr;
+	const char* suite = nullptr;
+	MemoryPageMode pageMode = MEMORY_PAGES_DEFAULT;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--quick") == 0) {
+			scale = 1;
+		}
+		else if (strcmp(argv[i], "--scale") == 0 && i + 1 < argc) {
+			scale = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--suite") == 0 && i + 1 < argc) {
+			suite = argv[++i];
+		}
+		else if (strcmp(argv[i], "--pages") == 0 && i + 1 < argc) {
+			i++;
+			if (strcmp(argv[i], "thp") == 0) {
+				pageMode = MEMORY_PAGES_TRANSPARENT_HUGE;
+			}
+			else if (strcmp(argv[i], "huge") == 0) {
+				pageMode = MEMORY_PAGES_HUGE;
+			}
+		}
+		else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+			outPath = argv[++i];
+		}
+		else {
+			fprintf(stderr, "Unknown argument '%s'.\n", argv[i]);
+			return -1;
+		}
+	}
+	if (scale == 0) {
+		scale = 1;
+	}
+
+	// No writer thread, the few messages of the allocators are written on the calling thread
+	Logger::SetLogLevel(LOG_LEVEL_WARN);
+
+	// Starts small so the growth path is part of the measurements
+	MemoryConfig memoryConfig{};
+	memoryConfig.s_HeapSize = 1024 * 1024 * 1024;
+	memoryConfig.s_HeapInitialCommitSize = 16 * 1024 * 1024;
+	memoryConfig.s_HeapPageMode = pageMode;
+	memoryConfig.s_FrameAllocatorSize = 4 * 1024 * 1024;
+	if (!Memory::Initialize(memoryConfig)) {
+		fprintf(stderr, "Cannot initialize memory system.\n");
+		return -1;
+	}
+
+	if (!suite || strcmp(suite, "memory") == 0) {
+		RunMemoryBenchmarks(scale);
+	}
+	if (!suite || strcmp(suite, "copy") == 0) {
+		RunCopyBenchmarks(scale);
+	}
+	if (!suite || strcmp(suite, "event") == 0) {
+		RunEventBenchmarks(scale);
+	}
+
+	FILE* file = stdout;
+	if (outPath) {
+		file = fopen(outPath, "w");
+		if (!file) {
+			fprintf(stderr, "Cannot open '%s' for writing.\n", outPath);
+			Memory::Shutdown();
+			return -1;
+		}
+	}
+	Benchmark::WriteJson(file);
+	if (file != stdout) {
+		fclose(file);
+	}
+
+	Memory::Shutdown();
+	return 0;
+}
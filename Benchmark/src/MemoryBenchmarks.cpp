@@ -0,0 +1,286 @@
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+#include "Benchmark.hpp"
+#include "core/Memory.hpp"
+#include "core/PoolAllocator.hpp"
+
+// Roughly the size of the small renderer wrapper objects that live in pools
+struct BenchmarkObject {
+	char s_Data[96];
+};
+
+struct CaseOutput {
+	unsigned long long s_Operations;
+	// Sampled at the largest live set, before the case cleans up
+	float s_Fragmentation;
+};
+
+// Adapters so every case drives each allocator through the same calls
+
+struct MallocAdapter {
+	static constexpr const char* Name = "malloc";
+	void* Allocate(unsigned int size) { return malloc(size); }
+	void Free(void* block, unsigned int size) { free(block); }
+	void EndFrame() {}
+	float GetFragmentation() { return BENCHMARK_NO_FRAGMENTATION; }
+};
+
+struct MemoryAdapter {
+	static constexpr const char* Name = "Memory";
+	void* Allocate(unsigned int size) { return Memory::Allocate(size, MEMORY_TAG_ARRAY); }
+	void Free(void* block, unsigned int size) { Memory::Free(block, size, MEMORY_TAG_ARRAY); }
+	void EndFrame() {}
+	float GetFragmentation() { return Memory::GetHeapStats().s_Fragmentation; }
+};
+
+struct FrameAdapter {
+	static constexpr const char* Name = "Memory::AllocateFrame";
+	void* Allocate(unsigned int size) { return Memory::AllocateFrame(size); }
+	void Free(void* block, unsigned int size) {}
+	void EndFrame() { Memory::ResetFrame(); }
+	float GetFragmentation() { return BENCHMARK_NO_FRAGMENTATION; }
+};
+
+// Pools only hand out one size, cases using them always request sizeof(BenchmarkObject)
+template<bool ThreadCache>
+struct PoolAdapter {
+	static constexpr const char* Name = ThreadCache ? "PoolAllocator+ThreadCache" : "PoolAllocator";
+	void* Allocate(unsigned int size) { return getPool().Allocate(); }
+	void Free(void* block, unsigned int size) { getPool().Free(block); }
+	void EndFrame() {}
+	float GetFragmentation() { return BENCHMARK_NO_FRAGMENTATION; }
+
+	static PoolAllocator<BenchmarkObject, ThreadCache>& getPool() {
+		static PoolAllocator<BenchmarkObject, ThreadCache> pool(Name, MEMORY_TAG_ARRAY);
+		return pool;
+	}
+};
+
+template<bool Timed, typename Allocator>
+static void* timedAllocate(Allocator& allocator, unsigned int size, LatencySamples& samples) {
+	void* block;
+	if constexpr (Timed) {
+		unsigned long long start = Benchmark::Now();
+		block = allocator.Allocate(size);
+		samples.Record(Benchmark::Now() - start);
+	}
+	else {
+		block = allocator.Allocate(size);
+	}
+	// Touch the block like a real user would, outside of the timed region
+	*(volatile char*)block = 1;
+	return block;
+}
+
+template<bool Timed, typename Allocator>
+static void timedFree(Allocator& allocator, void* block, unsigned int size, LatencySamples& samples) {
+	if constexpr (Timed) {
+		unsigned long long start = Benchmark::Now();
+		allocator.Free(block, size);
+		samples.Record(Benchmark::Now() - start);
+	}
+	else {
+		allocator.Free(block, size);
+	}
+}
+
+// Many short lived blocks that all die at the end of the frame
+struct FrameChurnCase {
+	static constexpr const char* Name = "frame_churn";
+	static constexpr unsigned int BlocksPerFrame = 256;
+	unsigned int s_Frames;
+	unsigned int s_Threads = 1;
+
+	template<bool Timed, typename Allocator>
+	CaseOutput Run(Allocator& allocator, LatencySamples& samples) const {
+		BenchmarkRandom random(0x5EED0001);
+		void* blocks[BlocksPerFrame];
+		unsigned int sizes[BlocksPerFrame];
+		CaseOutput output{ 0, allocator.GetFragmentation() };
+
+		for (unsigned int frame = 0; frame < s_Frames; frame++) {
+			for (unsigned int i = 0; i < BlocksPerFrame; i++) {
+				sizes[i] = random.NextSize(4, 10);
+				blocks[i] = timedAllocate<Timed>(allocator, sizes[i], samples);
+			}
+			// Free in a scrambled order, lifetimes inside a frame rarely nest
+			unsigned int start = random.Next() % BlocksPerFrame;
+			for (unsigned int i = 0; i < BlocksPerFrame; i++) {
+				unsigned int index = (start + i * 97) % BlocksPerFrame;
+				timedFree<Timed>(allocator, blocks[index], sizes[index], samples);
+			}
+			allocator.EndFrame();
+			output.s_Operations += BlocksPerFrame * 2;
+		}
+		return output;
+	}
+};
+
+// Bursts of mixed sizes from 16 bytes to 64KB replacing random live blocks,
+// the pattern that fragments a general purpose heap the most
+struct MixedBurstCase {
+	static constexpr const char* Name = "mixed_bursts";
+	static constexpr unsigned int LiveSlots = 4096;
+	unsigned int s_Bursts;
+	unsigned int s_Threads = 1;
+
+	template<bool Timed, typename Allocator>
+	CaseOutput Run(Allocator& allocator, LatencySamples& samples) const {
+		BenchmarkRandom random(0x5EED0002);
+		std::vector<void*> blocks(LiveSlots, nullptr);
+		std::vector<unsigned int> sizes(LiveSlots, 0);
+		CaseOutput output{ 0, BENCHMARK_NO_FRAGMENTATION };
+
+		for (unsigned int burst = 0; burst < s_Bursts; burst++) {
+			unsigned int count = 32 + random.Next() % 224;
+			for (unsigned int i = 0; i < count; i++) {
+				unsigned int slot = random.Next() % LiveSlots;
+				if (blocks[slot]) {
+					timedFree<Timed>(allocator, blocks[slot], sizes[slot], samples);
+					output.s_Operations++;
+				}
+				sizes[slot] = random.NextSize(4, 15);
+				blocks[slot] = timedAllocate<Timed>(allocator, sizes[slot], samples);
+				output.s_Operations++;
+			}
+			for (unsigned int i = 0; i < count / 2; i++) {
+				unsigned int slot = random.Next() % LiveSlots;
+				if (blocks[slot]) {
+					timedFree<Timed>(allocator, blocks[slot], sizes[slot], samples);
+					blocks[slot] = nullptr;
+					output.s_Operations++;
+				}
+			}
+		}
+
+		output.s_Fragmentation = allocator.GetFragmentation();
+		for (unsigned int slot = 0; slot < LiveSlots; slot++) {
+			if (blocks[slot]) {
+				allocator.Free(blocks[slot], sizes[slot]);
+			}
+		}
+		return output;
+	}
+};
+
+// Every step frees the oldest block of a sliding window and allocates a new one.
+// With Threads > 1 each thread runs its own window against the shared allocator.
+struct WindowChurnCase {
+	const char* Name;
+	unsigned int s_Steps;
+	unsigned int s_Threads;
+	// 0 picks random sizes from 16 to 512 bytes
+	unsigned int s_FixedSize;
+
+	static constexpr unsigned int WindowSize = 64;
+
+	template<bool Timed, typename Allocator>
+	void runThread(Allocator& allocator, unsigned int thread, LatencySamples& samples) const {
+		BenchmarkRandom random(0x5EED0003 + thread);
+		void* blocks[WindowSize] = {};
+		unsigned int sizes[WindowSize] = {};
+
+		for (unsigned int step = 0; step < s_Steps; step++) {
+			unsigned int slot = step % WindowSize;
+			if (blocks[slot]) {
+				timedFree<Timed>(allocator, blocks[slot], sizes[slot], samples);
+			}
+			sizes[slot] = s_FixedSize ? s_FixedSize : random.NextSize(4, 9);
+			blocks[slot] = timedAllocate<Timed>(allocator, sizes[slot], samples);
+		}
+		for (unsigned int slot = 0; slot < WindowSize; slot++) {
+			if (blocks[slot]) {
+				allocator.Free(blocks[slot], sizes[slot]);
+			}
+		}
+	}
+
+	template<bool Timed, typename Allocator>
+	CaseOutput Run(Allocator& allocator, LatencySamples& samples) const {
+		CaseOutput output{ (unsigned long long)s_Steps * 2 * s_Threads, BENCHMARK_NO_FRAGMENTATION };
+		if (s_Threads == 1) {
+			runThread<Timed>(allocator, 0, samples);
+			return output;
+		}
+
+		std::vector<LatencySamples> threadSamples(s_Threads);
+		std::vector<std::thread> threads;
+		for (unsigned int i = 0; i < s_Threads; i++) {
+			if constexpr (Timed) {
+				threadSamples[i].Reserve((size_t)s_Steps * 2);
+			}
+			threads.emplace_back([this, &allocator, &threadSamples, i]() {
+				runThread<Timed>(allocator, i, threadSamples[i]);
+			});
+		}
+		for (std::thread& thread : threads) {
+			thread.join();
+		}
+		for (const LatencySamples& thread : threadSamples) {
+			samples.Append(thread);
+		}
+		return output;
+	}
+};
+
+// Warm up, then one untimed pass for throughput and one pass that times every operation
+template<typename Allocator, typename Case>
+static void runCase(const Case& benchmarkCase) {
+	Allocator allocator;
+	LatencySamples samples;
+
+	benchmarkCase.template Run<false>(allocator, samples);
+
+	unsigned long long start = Benchmark::Now();
+	CaseOutput output = benchmarkCase.template Run<false>(allocator, samples);
+	unsigned long long elapsed = Benchmark::Now() - start;
+
+	samples.Reserve((size_t)output.s_Operations);
+	benchmarkCase.template Run<true>(allocator, samples);
+
+	BenchmarkResult result{};
+	result.s_Name = benchmarkCase.Name;
+	result.s_Variant = Allocator::Name;
+	result.s_Threads = benchmarkCase.s_Threads;
+	result.s_Operations = output.s_Operations;
+	result.s_NsPerOp = (double)elapsed * benchmarkCase.s_Threads / (double)output.s_Operations;
+	result.s_P50Ns = samples.Percentile(0.50);
+	result.s_P99Ns = samples.Percentile(0.99);
+	result.s_PeakRss = Benchmark::GetPeakRss();
+	result.s_Fragmentation = output.s_Fragmentation;
+	Benchmark::Report(result);
+}
+
+void RunMemoryBenchmarks(unsigned int scale) {
+	FrameChurnCase frameChurn{ 400 * scale };
+	runCase<MallocAdapter>(frameChurn);
+	runCase<MemoryAdapter>(frameChurn);
+	runCase<FrameAdapter>(frameChurn);
+
+	MixedBurstCase mixedBursts{ 200 * scale };
+	runCase<MallocAdapter>(mixedBursts);
+	runCase<MemoryAdapter>(mixedBursts);
+
+	WindowChurnCase pooledObjects{ "pool_objects", 100000 * scale, 1, sizeof(BenchmarkObject) };
+	runCase<MallocAdapter>(pooledObjects);
+	runCase<MemoryAdapter>(pooledObjects);
+	runCase<PoolAdapter<false>>(pooledObjects);
+	runCase<PoolAdapter<true>>(pooledObjects);
+
+	unsigned int maxThreads = std::thread::hardware_concurrency();
+	if (maxThreads > 8) {
+		maxThreads = 8;
+	}
+	for (unsigned int threads = 2; threads <= maxThreads; threads *= 2) {
+		WindowChurnCase mixedThreaded{ "threaded_churn", 50000 * scale, threads, 0 };
+		runCase<MallocAdapter>(mixedThreaded);
+		runCase<MemoryAdapter>(mixedThreaded);
+
+		WindowChurnCase pooledThreaded{ "threaded_pool_objects", 50000 * scale, threads, sizeof(BenchmarkObject) };
+		runCase<MallocAdapter>(pooledThreaded);
+		runCase<PoolAdapter<false>>(pooledThreaded);
+		runCase<PoolAdapter<true>>(pooledThreaded);
+	}
+}
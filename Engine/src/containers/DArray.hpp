@@ -0,0 +1,201 @@
+#pragma once
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "core/Logger.hpp"
+#include "core/Memory.hpp"
+
+// Dynamic array that allocates through Memory (MEMORY_TAG_DARRAY) and grows geometrically.
+// The first InlineCapacity elements live inside the array itself, so small arrays never
+// touch the heap. Trivially copyable element types are moved around with Memory::Copy.
+template<typename T, size_t InlineCapacity = 0>
+class DArray {
+	// Heap blocks are only aligned that far
+	static_assert(alignof(T) <= HEAP_ALIGNMENT, "DArray elements cannot be aligned beyond HEAP_ALIGNMENT.");
+public:
+	DArray() : m_Data(inlineData()), m_Capacity(InlineCapacity) {}
+
+	DArray(const DArray& other) : DArray() {
+		Reserve(other.m_Size);
+		copyConstruct(m_Data, other.m_Data, other.m_Size);
+		m_Size = other.m_Size;
+	}
+
+	DArray(DArray&& other) noexcept : DArray() {
+		moveFrom(other);
+	}
+
+	~DArray() {
+		Clear();
+		release();
+	}
+
+	DArray& operator=(const DArray& other) {
+		if (this != &other) {
+			Clear();
+			Reserve(other.m_Size);
+			copyConstruct(m_Data, other.m_Data, other.m_Size);
+			m_Size = other.m_Size;
+		}
+		return *this;
+	}
+
+	DArray& operator=(DArray&& other) noexcept {
+		if (this != &other) {
+			Clear();
+			release();
+			m_Data = inlineData();
+			m_Capacity = InlineCapacity;
+			moveFrom(other);
+		}
+		return *this;
+	}
+
+	void Reserve(size_t capacity) {
+		if (capacity > m_Capacity) {
+			reallocate(capacity);
+		}
+	}
+
+	// Value initializes new elements and destroys the ones cut off
+	void Resize(size_t size) {
+		Reserve(size);
+		for (size_t i = m_Size; i < size; i++) {
+			new (&m_Data[i]) T();
+		}
+		for (size_t i = size; i < m_Size; i++) {
+			m_Data[i].~T();
+		}
+		m_Size = size;
+	}
+
+	void PushBack(const T& value) {
+		if (m_Size == m_Capacity) {
+			// value may live inside this array, copy it out before growing
+			T copy(value);
+			EmplaceBack(std::move(copy));
+			return;
+		}
+		EmplaceBack(value);
+	}
+
+	void PushBack(T&& value) {
+		EmplaceBack(std::move(value));
+	}
+
+	template<typename... Args>
+	T& EmplaceBack(Args&&... args) {
+		if (m_Size == m_Capacity) {
+			reallocate(m_Capacity < 4 ? 4 : m_Capacity * 2);
+		}
+		T* element = new (&m_Data[m_Size]) T(std::forward<Args>(args)...);
+		m_Size++;
+		return *element;
+	}
+
+	void PopBack() {
+		if (m_Size > 0) {
+			m_Data[--m_Size].~T();
+		}
+	}
+
+	// Destroys all elements but keeps the capacity
+	void Clear() {
+		if constexpr (!std::is_trivially_destructible<T>::value) {
+			for (size_t i = 0; i < m_Size; i++) {
+				m_Data[i].~T();
+			}
+		}
+		m_Size = 0;
+	}
+
+	size_t Size() const { return m_Size; }
+	size_t Capacity() const { return m_Capacity; }
+	bool Empty() const { return m_Size == 0; }
+
+	T* Data() { return m_Data; }
+	const T* Data() const { return m_Data; }
+
+	T& operator[](size_t index) { return m_Data[index]; }
+	const T& operator[](size_t index) const { return m_Data[index]; }
+
+	T* begin() { return m_Data; }
+	T* end() { return m_Data + m_Size; }
+	const T* begin() const { return m_Data; }
+	const T* end() const { return m_Data + m_Size; }
+private:
+	T* inlineData() { return InlineCapacity > 0 ? (T*)m_Inline : nullptr; }
+	bool isInline() const { return InlineCapacity > 0 && m_Data == (const T*)m_Inline; }
+
+	void reallocate(size_t capacity) {
+		T* data = (T*)Memory::Allocate(sizeof(T) * capacity, MEMORY_TAG_DARRAY);
+		if (!data) {
+			// Even the system heap is out, callers index the new elements right away
+			EN_FATAL("DArray failed to allocate %llu bytes.", (unsigned long long)(sizeof(T) * capacity));
+			std::abort();
+		}
+		moveConstruct(data, m_Data, m_Size);
+		release();
+		m_Data = data;
+		m_Capacity = capacity;
+	}
+
+	// Frees the heap block, if any. Elements have to be destroyed or moved out before.
+	void release() {
+		if (m_Data && !isInline()) {
+			Memory::Free(m_Data, sizeof(T) * m_Capacity, MEMORY_TAG_DARRAY);
+		}
+	}
+
+	void moveFrom(DArray& other) {
+		if (other.isInline() || !other.m_Data) {
+			// Inline elements cannot be stolen, move them one by one
+			moveConstruct(m_Data, other.m_Data, other.m_Size);
+			m_Size = other.m_Size;
+			other.m_Size = 0;
+		}
+		else {
+			m_Data = other.m_Data;
+			m_Size = other.m_Size;
+			m_Capacity = other.m_Capacity;
+			other.m_Data = other.inlineData();
+			other.m_Size = 0;
+			other.m_Capacity = InlineCapacity;
+		}
+	}
+
+	// Moves count elements into uninitialized dst and destroys them in src
+	static void moveConstruct(T* dst, T* src, size_t count) {
+		if constexpr (std::is_trivially_copyable<T>::value) {
+			if (count > 0) {
+				Memory::Copy(dst, src, sizeof(T) * count);
+			}
+		}
+		else {
+			for (size_t i = 0; i < count; i++) {
+				new (&dst[i]) T(std::move(src[i]));
+				src[i].~T();
+			}
+		}
+	}
+
+	static void copyConstruct(T* dst, const T* src, size_t count) {
+		if constexpr (std::is_trivially_copyable<T>::value) {
+			if (count > 0) {
+				Memory::Copy(dst, src, sizeof(T) * count);
+			}
+		}
+		else {
+			for (size_t i = 0; i < count; i++) {
+				new (&dst[i]) T(src[i]);
+			}
+		}
+	}
+private:
+	T* m_Data;
+	size_t m_Size = 0;
+	size_t m_Capacity;
+	alignas(T) unsigned char m_Inline[InlineCapacity > 0 ? InlineCapacity * sizeof(T) : 1];
+};
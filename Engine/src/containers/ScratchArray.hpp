@@ -0,0 +1,84 @@
+#pragma once
+#include <type_traits>
+
+#include "core/Memory.hpp"
+#include "core/Logger.hpp"
+
+// Growable array that lives in the frame allocator. Its memory is reclaimed in bulk
+// by Memory::ResetFrame, so it must never outlive the frame it was created in.
+// Once the frame allocator is exhausted it falls back to the heap and frees that block itself.
+template<typename T>
+class ScratchArray {
+	static_assert(std::is_trivially_destructible<T>::value, "ScratchArray elements are never destructed.");
+	static_assert(alignof(T) <= HEAP_ALIGNMENT, "ScratchArray elements have to fit the heap alignment for the fallback.");
+public:
+	ScratchArray(size_t capacity = 8) {
+		Grow(capacity > 0 ? capacity : 1);
+	}
+	~ScratchArray() {
+		releaseHeapBlock();
+	}
+	ScratchArray(const ScratchArray&) = delete;
+	ScratchArray& operator=(const ScratchArray&) = delete;
+
+	void PushBack(const T& value) {
+		if (m_Size == m_Capacity && !Grow(m_Capacity * 2)) {
+			return;
+		}
+		m_Data[m_Size++] = value;
+	}
+
+	// Value initializes new elements
+	void Resize(size_t size) {
+		if (size > m_Capacity && !Grow(size)) {
+			return;
+		}
+		for (size_t i = m_Size; i < size; i++) {
+			m_Data[i] = T{};
+		}
+		m_Size = size;
+	}
+
+	void Clear() { m_Size = 0; }
+
+	size_t Size() const { return m_Size; }
+	T* Data() { return m_Data; }
+
+	T& operator[](size_t index) { return m_Data[index]; }
+	const T& operator[](size_t index) const { return m_Data[index]; }
+private:
+	bool Grow(size_t capacity) {
+		// An old frame block stays in the frame allocator until the next reset
+		bool onHeap = false;
+		T* data = (T*)Memory::AllocateFrame(sizeof(T) * capacity, alignof(T));
+		if (!data) {
+			data = (T*)Memory::Allocate(sizeof(T) * capacity, MEMORY_TAG_FRAME);
+			onHeap = true;
+		}
+		if (!data) {
+			EN_FATAL("ScratchArray could not allocate %llu bytes from the frame allocator or the heap.", (unsigned long long)(sizeof(T) * capacity));
+			return false;
+		}
+		if (m_Size > 0) {
+			Memory::Copy(data, m_Data, sizeof(T) * m_Size);
+		}
+		releaseHeapBlock();
+		m_Data = data;
+		m_Capacity = capacity;
+		m_OnHeap = onHeap;
+		return true;
+	}
+
+	void releaseHeapBlock() {
+		if (m_OnHeap) {
+			Memory::Free(m_Data, sizeof(T) * m_Capacity, MEMORY_TAG_FRAME);
+			m_OnHeap = false;
+		}
+	}
+private:
+	T* m_Data = nullptr;
+	size_t m_Size = 0;
+	size_t m_Capacity = 0;
+	// Set when the frame allocator was exhausted and m_Data came from the heap
+	bool m_OnHeap = false;
+};
@@ -6,7 +6,9 @@
 #include "Platform.hpp"
 #include "Memory.hpp"
 #include "Event.hpp"
+#include "EventChannel.hpp"
 #include "Input.hpp"
+#include "Profiler.hpp"
 
 Systems::Systems(const SystemsConfig& config) :
 	s_Platform({ config.s_Name, config.s_Width, config.s_Heigth }),
@@ -22,53 +24,84 @@ Application::Application(const ApplicationConfig& config) :
 	m_Config.s_Width = config.s_Width;
 	m_Config.s_Name = config.s_Name;
 	m_Config.TargetTicksPerSecond = config.TargetTicksPerSecond;
+	m_Config.s_RecordEventsPath = config.s_RecordEventsPath;
+	m_Config.s_ReplayEventsPath = config.s_ReplayEventsPath;
+	m_Config.s_ReplayMode = config.s_ReplayMode;
+	m_Config.s_EventStatsDumpInterval = config.s_EventStatsDumpInterval;
 
 	if (!EventSystem::Initialize()) {
 		EN_FATAL("Cannot initialize event system. Shutting down.");
 	}
 
-	// Logger does not require config and no checkup on initialization
-	Logger::Initialize(LOG_LEVEL_TRACE);
+	EventSystem::SetStatsDumpInterval(config.s_EventStatsDumpInterval);
 
 	// Register on event functions
 	// OnClose
-	EventSystem::RegisterEvent(nullptr, EVENT_TYPE_WINDOW_CLOSE,
-		[&](const void* sender, EventContext context, EventType type)
+	m_CloseBridge = EventChannel<WindowCloseEvent>::Bridge();
+	EventChannel<WindowCloseEvent>::Subscribe(
+		[&](const WindowCloseEvent&)
 		{
 			m_Running = false;
 			return true;
 		});
 	// OnResize
-	EventSystem::RegisterEvent(nullptr, EVENT_TYPE_WINDOW_RESIZE,
+	m_ResizeListener = EventSystem::RegisterEvent(nullptr, EVENT_TYPE_WINDOW_RESIZE,
 		[&](const void* sender, EventContext context, EventType type)
 		{ 
 			m_Systems.s_Renderer.OnResize(sender, context, type);
 			EN_DEBUG("Window resized to (%u width, %u height): ", context.u32[0], context.u32[1]);
 			return true;
 		});
-	// OnKeyPressed
-	EventSystem::RegisterEvent(nullptr, EVENT_TYPE_KEY_PRESSED,
-		[&](const void* sender, EventContext context, EventType type)
-		{
-			EN_DEBUG("Key pressed: %c", context.u32[0]);
-			return true;
-		});
+	// OnKeyPressed, fixed at compile time
+	m_KeyPressedBridge = EventDispatcher<KeyPressedEvent, &Application::onKeyPressed>::Bridge();
+
+	if (config.s_ReplayEventsPath) {
+		EventSystem::StartReplay(config.s_ReplayEventsPath, config.s_ReplayMode);
+	}
+	else if (config.s_RecordEventsPath) {
+		EventSystem::StartRecording(config.s_RecordEventsPath);
+	}
 
 	m_Running = true;
 }
 
 Application::~Application() {
+	EventSystem::UnregisterEvent(m_CloseBridge);
+	EventSystem::UnregisterEvent(m_ResizeListener);
+	EventSystem::UnregisterEvent(m_KeyPressedBridge);
+	// The typed listeners capture this
+	EventChannel<WindowCloseEvent>::Clear();
 	EventSystem::Shutdown();
 }
 
+void Application::onKeyPressed(const KeyPressedEvent& event) {
+	EN_DEBUG("Key pressed: %c", event.s_Code);
+}
+
 void Application::run() {
 	Memory::PrintMemoryStats();
+	m_Systems.s_Renderer.printMemoryStats();
 	m_Clock.Start();
 
-	unsigned long frameCount = 0;
 	while (m_Running) {
-		m_Systems.s_Platform.pumpMessages();
-		Input::Update();
+		// Closes the zone of the last frame and folds it into the rolling averages
+		Profiler::NewFrame();
+		// Everything allocated from the frame allocator last frame is released here
+		Memory::ResetFrame();
+
+		{
+			EN_PROFILE_SCOPE("Platform::pumpMessages");
+			m_Systems.s_Platform.pumpMessages();
+		}
+		{
+			EN_PROFILE_SCOPE("Events and input");
+			// Fires the recorded events of this frame during a replay
+			EventSystem::BeginFrame();
+			// Applies the input samples of this frame and posts their events
+			Input::Update();
+			// Window, input and worker thread events are only handled here, in one batch
+			EventSystem::DispatchQueued();
+		}
 
 		if (!m_Systems.s_Renderer.beginFrame()) {
 			// Swapchain is likely rebooting and we need to acquire a 
@@ -81,10 +114,9 @@ void Application::run() {
 		m_Systems.s_Renderer.endFrame();
 
 		if (m_Clock.GetElapsed() >= 1.0) {
-			EN_DEBUG("Frames per second: %u", frameCount);
+			// Averages over the last frames, with the time of every zone
+			Profiler::PrintStats();
 			m_Clock.Start();
-			frameCount = 0;
 		}
-		frameCount++;
 	}
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 #include "Event.hpp"
+#include "EventChannel.hpp"
 #include "Clock.hpp"
 #include "Platform.hpp"
 #include "renderer/vulkan/VulkanRenderer.hpp"
@@ -9,6 +10,12 @@ struct ApplicationConfig {
 	unsigned int s_Width;
 	unsigned int s_Height;
 	const char* s_Name;
+	// Optional event log to write, or to replay instead of the live input
+	const char* s_RecordEventsPath;
+	const char* s_ReplayEventsPath;
+	EventReplayMode s_ReplayMode;
+	// Frames between two event handler tables in debug builds, 0 turns them off
+	unsigned int s_EventStatsDumpInterval;
 };
 
 //class Platform;
@@ -34,14 +41,21 @@ public:
 
 	void run();
 	
-	//On Event functions are currently defined as lambdas in constructor
+	//On Event functions are currently defined as lambdas in constructor,
+	//except the ones that need no instance
 
 	const ApplicationConfig getConfig() { return m_Config; }
 public:
 	Systems m_Systems;
 private:
+	static void onKeyPressed(const KeyPressedEvent& event);
+
 	Clock m_Clock;
 	ApplicationConfig m_Config{};
 	bool m_Running;
+	// Unregistered before the listeners that capture this go away
+	EventListenerHandle m_CloseBridge;
+	EventListenerHandle m_ResizeListener;
+	EventListenerHandle m_KeyPressedBridge;
 };
 
@@ -0,0 +1,139 @@
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Bytes of capture a delegate holds by default, enough for a few pointers
+#define DELEGATE_DEFAULT_CAPACITY 32
+
+template<typename Signature, size_t Capacity = DELEGATE_DEFAULT_CAPACITY>
+class Delegate;
+
+// Callable wrapper like std::function, but the callable always lives in the inline
+// buffer. Captures that do not fit are a compile error instead of a heap allocation,
+// and a call is a single indirect call through m_Invoke.
+template<typename R, typename... Args, size_t Capacity>
+class Delegate<R(Args...), Capacity> {
+public:
+	Delegate() = default;
+	Delegate(std::nullptr_t) {}
+
+	template<typename F, typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, Delegate>::value>::type>
+	Delegate(F&& callable) {
+		typedef typename std::decay<F>::type Callable;
+		static_assert(sizeof(Callable) <= Capacity, "Capture is too large for the delegate. Capture a pointer or raise the capacity.");
+		static_assert(alignof(Callable) <= alignof(std::max_align_t), "Capture is over aligned for the delegate.");
+		static_assert(std::is_invocable_r<R, Callable&, Args...>::value, "Callable does not match the delegate signature.");
+
+		new (m_Storage) Callable(std::forward<F>(callable));
+		m_Invoke = &invoke<Callable>;
+		if constexpr (!std::is_trivially_copyable<Callable>::value || !std::is_trivially_destructible<Callable>::value) {
+			m_Manage = &manage<Callable>;
+		}
+	}
+
+	Delegate(const Delegate& other) {
+		copyFrom(other);
+	}
+
+	Delegate(Delegate&& other) noexcept {
+		moveFrom(other);
+	}
+
+	~Delegate() {
+		reset();
+	}
+
+	Delegate& operator=(const Delegate& other) {
+		if (this != &other) {
+			reset();
+			copyFrom(other);
+		}
+		return *this;
+	}
+
+	Delegate& operator=(Delegate&& other) noexcept {
+		if (this != &other) {
+			reset();
+			moveFrom(other);
+		}
+		return *this;
+	}
+
+	Delegate& operator=(std::nullptr_t) {
+		reset();
+		return *this;
+	}
+
+	explicit operator bool() const { return m_Invoke != nullptr; }
+
+	R operator()(Args... args) const {
+		return m_Invoke((void*)m_Storage, std::forward<Args>(args)...);
+	}
+private:
+	enum Operation {
+		OPERATION_COPY,
+		OPERATION_MOVE,
+		OPERATION_DESTROY,
+	};
+
+	template<typename Callable>
+	static R invoke(void* storage, Args... args) {
+		return (*(Callable*)storage)(std::forward<Args>(args)...);
+	}
+
+	// Only set for callables that cannot be copied bytewise
+	template<typename Callable>
+	static void manage(Operation operation, void* dest, void* src) {
+		switch (operation) {
+			case OPERATION_COPY:
+				new (dest) Callable(*(const Callable*)src);
+				break;
+			case OPERATION_MOVE:
+				new (dest) Callable(std::move(*(Callable*)src));
+				((Callable*)src)->~Callable();
+				break;
+			case OPERATION_DESTROY:
+				((Callable*)dest)->~Callable();
+				break;
+		}
+	}
+
+	void copyFrom(const Delegate& other) {
+		if (other.m_Manage) {
+			other.m_Manage(OPERATION_COPY, m_Storage, (void*)other.m_Storage);
+		}
+		else if (other.m_Invoke) {
+			std::memcpy(m_Storage, other.m_Storage, Capacity);
+		}
+		m_Invoke = other.m_Invoke;
+		m_Manage = other.m_Manage;
+	}
+
+	void moveFrom(Delegate& other) {
+		if (other.m_Manage) {
+			other.m_Manage(OPERATION_MOVE, m_Storage, other.m_Storage);
+		}
+		else if (other.m_Invoke) {
+			std::memcpy(m_Storage, other.m_Storage, Capacity);
+		}
+		m_Invoke = other.m_Invoke;
+		m_Manage = other.m_Manage;
+		other.m_Invoke = nullptr;
+		other.m_Manage = nullptr;
+	}
+
+	void reset() {
+		if (m_Manage) {
+			m_Manage(OPERATION_DESTROY, m_Storage, nullptr);
+		}
+		m_Invoke = nullptr;
+		m_Manage = nullptr;
+	}
+
+	alignas(std::max_align_t) char m_Storage[Capacity];
+	R (*m_Invoke)(void* storage, Args... args) = nullptr;
+	void (*m_Manage)(Operation operation, void* dest, void* src) = nullptr;
+};
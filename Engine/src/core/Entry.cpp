@@ -1,15 +1,82 @@
 #include <iostream>
+#include <string.h>
 #include "Application.hpp"
 #include "containers/Array.hpp"
 #include "Logger.hpp"
+#include "LogFile.hpp"
+#include "Memory.hpp"
+#include "Profiler.hpp"
 
-int main() {
+// Usage: Engine [--record-events file] [--replay-events file] [--replay-fast] [--binary-log file] [--log-file path] [--profile-trace file]
+//        Engine --decode-log file
+int main(int argc, char** argv) {
+	const char* binaryLogPath = nullptr;
+	const char* profileTracePath = nullptr;
+	LogFileConfig logFileConfig{};
 	ApplicationConfig config{};
 	config.s_Width = 1920;
 	config.s_Height = 1080;
 	config.s_Name = "Engine";
 	config.TargetTicksPerSecond = 60;
+	config.s_ReplayMode = EVENT_REPLAY_ORIGINAL_CADENCE;
+	config.s_EventStatsDumpInterval = 3600;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--record-events") == 0 && i + 1 < argc) {
+			config.s_RecordEventsPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--replay-events") == 0 && i + 1 < argc) {
+			config.s_ReplayEventsPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--replay-fast") == 0) {
+			config.s_ReplayMode = EVENT_REPLAY_AS_FAST_AS_POSSIBLE;
+		}
+		else if (strcmp(argv[i], "--binary-log") == 0 && i + 1 < argc) {
+			binaryLogPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--log-file") == 0 && i + 1 < argc) {
+			logFileConfig.s_Path = argv[++i];
+		}
+		else if (strcmp(argv[i], "--profile-trace") == 0 && i + 1 < argc) {
+			// Chrome trace of the last frames, written on shutdown
+			profileTracePath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--decode-log") == 0 && i + 1 < argc) {
+			// Prints a binary log from an earlier run and exits
+			return Logger::DecodeBinaryLog(argv[i + 1], stdout) ? 0 : -1;
+		}
+	}
 
-	Application app(config);
-	app.run();
+	// Logger is the first system up and the last one down, everything before it logs synchronously
+	if (logFileConfig.s_Path && LogFile::Open(logFileConfig)) {
+		Logger::AddSink(LogFile::Write);
+	}
+	Logger::Initialize(LOG_LEVEL_TRACE, binaryLogPath);
+	Profiler::Initialize(profileTracePath);
+
+	// Memory has to be up before any system allocates through it
+	MemoryConfig memoryConfig{};
+	// Address space is cheap, large scenes grow into it without moving anything
+	memoryConfig.s_HeapSize = 4ULL * 1024 * 1024 * 1024;
+	memoryConfig.s_HeapInitialCommitSize = 64 * 1024 * 1024;
+	memoryConfig.s_HeapPageMode = MEMORY_PAGES_TRANSPARENT_HUGE;
+	memoryConfig.s_FrameAllocatorSize = 4 * 1024 * 1024;
+	memoryConfig.s_LoadStackSize = 64 * 1024 * 1024;
+	memoryConfig.s_StatsDumpInterval = 3600;
+	if (!Memory::Initialize(memoryConfig)) {
+		EN_FATAL("Cannot initialize memory system. Shutting down.");
+		Profiler::Shutdown();
+		Logger::Shutdown();
+		LogFile::Close();
+		return -1;
+	}
+
+	{
+		Application app(config);
+		app.run();
+	}
+
+	Memory::Shutdown();
+	Profiler::Shutdown();
+	Logger::Shutdown();
+	LogFile::Close();
 } 
\ No newline at end of file
@@ -1,81 +1,650 @@
+#include <chrono>
+#include <thread>
+
 #include "Event.hpp"
-#include "Defines.hpp"
 #include "Logger.hpp"
 
 RegisteredEvent::RegisteredEvent(const void* sender, EventType type, pfnOnEvent callback) {
 	this->m_ID = INVALID_ID;
-	this->m_Callback = callback;
+	this->m_Callback = std::move(callback);
 	this->m_Type = type;
 }
 
-unsigned int EventSystem::m_IDCounter;
-Array<RegisteredEvent, MAX_REGISTERED_EVENT_CALLBACKS> EventSystem::m_RegisteredEvents;
+DArray<RegisteredEvent, EVENT_LISTENER_INLINE_CAPACITY> EventSystem::m_Listeners[EVENT_TYPE_MAX];
+DArray<RegisteredEvent> EventSystem::m_PendingListeners;
+DArray<unsigned int> EventSystem::m_PendingRemovals;
+EventListenerSlot EventSystem::m_Slots[MAX_REGISTERED_EVENT_CALLBACKS];
+unsigned int EventSystem::m_FreeSlot;
+unsigned int EventSystem::m_DispatchDepth;
+
+QueuedEvent EventSystem::m_Queue[EVENT_QUEUE_CAPACITY];
+PostedEvent EventSystem::m_Batch[EVENT_QUEUE_CAPACITY];
+EventCoalescePolicy EventSystem::m_CoalescePolicies[EVENT_TYPE_MAX];
+unsigned long long EventSystem::m_Coalesced;
+
+unsigned int EventSystem::m_Frame;
+bool EventSystem::m_Recording;
+File EventSystem::m_RecordFile;
+EventRecord EventSystem::m_RecordBuffer[EVENT_RECORD_BUFFER_SIZE];
+unsigned int EventSystem::m_RecordCount;
+unsigned int EventSystem::m_RecordStartFrame;
+unsigned long long EventSystem::m_RecordStartNs;
+bool EventSystem::m_Replaying;
+EventReplayMode EventSystem::m_ReplayMode;
+DArray<EventRecord> EventSystem::m_ReplayRecords;
+size_t EventSystem::m_ReplayCursor;
+size_t EventSystem::m_ReplayFrameEnd;
+unsigned int EventSystem::m_ReplayStartFrame;
+unsigned long long EventSystem::m_ReplayStartNs;
+
+#ifdef EVENT_INSTRUMENTATION
+const char* EventSystem::m_EventTypeStrings[EVENT_TYPE_MAX] = {
+	"EVENT_TYPE_MOUSE_MOVED",
+	"EVENT_TYPE_MOUSE_CLICKED",
+	"EVENT_TYPE_MOUSE_RELEASED",
+	"EVENT_TYPE_MOUSE_SCROLLED",
+	"EVENT_TYPE_KEY_DOWN",
+	"EVENT_TYPE_KEY_RELEASED",
+	"EVENT_TYPE_KEY_PRESSED",
+	"EVENT_TYPE_WINDOW_RESIZE",
+	"EVENT_TYPE_WINDOW_CLOSE",
+	"EVENT_TYPE_WINDOW_MOVED",
+};
+EventHandlerStats EventSystem::m_TypeStats[2][EVENT_TYPE_MAX];
+EventHandlerStats EventSystem::m_ListenerStats[2][MAX_REGISTERED_EVENT_CALLBACKS];
+unsigned int EventSystem::m_StatsFrame;
+unsigned long long EventSystem::m_HandlerBudgetNs = EVENT_DEFAULT_HANDLER_BUDGET_NS;
+unsigned int EventSystem::m_StatsDumpInterval;
+#endif
+alignas(64) std::atomic<unsigned long long> EventSystem::m_QueueHead;
+alignas(64) std::atomic<unsigned long long> EventSystem::m_QueueTail;
+std::atomic<unsigned long long> EventSystem::m_QueueOverflows;
+unsigned long long EventSystem::m_ReportedOverflows;
+unsigned int EventSystem::m_LastQueueDepth;
+unsigned int EventSystem::m_PeakQueueDepth;
 
 bool EventSystem::Initialize() {
-	m_IDCounter = 0;
-	
-	// Invalidate all registered events
-	for (int i = 0; i < m_RegisteredEvents.Size(); i++) {
-		RegisteredEvent e(nullptr, EVENT_TYPE_MAX, nullptr);
-		e.SetID(INVALID_ID);
-		e.GetID();
+	m_DispatchDepth = 0;
+	m_Frame = 0;
+
+	for (int i = 0; i < EVENT_TYPE_MAX; i++) {
+		m_Listeners[i].Clear();
+	}
+	m_PendingListeners.Clear();
+	m_PendingRemovals.Clear();
 
-		m_RegisteredEvents[i] = e;
+	// Chain every handle slot into the free list, generations survive a restart
+	for (unsigned int i = 0; i < MAX_REGISTERED_EVENT_CALLBACKS; i++) {
+		m_Slots[i].s_NextFree = i + 1 < MAX_REGISTERED_EVENT_CALLBACKS ? i + 1 : INVALID_ID;
+		m_Slots[i].s_InUse = false;
+		m_Slots[i].s_Pending = false;
 	}
+	m_FreeSlot = 0;
+
+	// Slot i is free for the producer that claims position i
+	for (unsigned int i = 0; i < EVENT_QUEUE_CAPACITY; i++) {
+		m_Queue[i].s_Sequence.store(i, std::memory_order_relaxed);
+	}
+	m_QueueHead.store(0, std::memory_order_relaxed);
+	m_QueueTail.store(0, std::memory_order_relaxed);
+	m_QueueOverflows.store(0, std::memory_order_relaxed);
+	m_ReportedOverflows = 0;
+	m_LastQueueDepth = 0;
+	m_PeakQueueDepth = 0;
+	m_Coalesced = 0;
+
+	// Only the end state of a frame of moves and resizes matters, wheel deltas add up.
+	// Resizes collapsing into one is what keeps a drag resize at one swapchain rebuild per frame.
+	for (int i = 0; i < EVENT_TYPE_MAX; i++) {
+		m_CoalescePolicies[i] = EVENT_COALESCE_KEEP_ALL;
+	}
+	m_CoalescePolicies[EVENT_TYPE_MOUSE_MOVED] = EVENT_COALESCE_KEEP_LAST;
+	m_CoalescePolicies[EVENT_TYPE_MOUSE_SCROLLED] = EVENT_COALESCE_ACCUMULATE;
+	m_CoalescePolicies[EVENT_TYPE_WINDOW_RESIZE] = EVENT_COALESCE_KEEP_LAST;
+	m_CoalescePolicies[EVENT_TYPE_WINDOW_MOVED] = EVENT_COALESCE_KEEP_LAST;
 	return true;
 }
 
-bool EventSystem::RegisterEvent(const void* sender, EventType type, pfnOnEvent callback) {
-	if (callback) {
-		// Find empty slot in the registered events
-		for (int i = 0; i < m_RegisteredEvents.Size(); i++) {
-			if (m_RegisteredEvents[i].GetID() == INVALID_ID) {
-				// Empty slot found
-				m_RegisteredEvents[i].SetCallback(callback);
-				m_RegisteredEvents[i].SetID(m_IDCounter);
-				m_RegisteredEvents[i].SetType(type);
-				// Increase ID counter
-				m_IDCounter++;
-				break;
-			}
-			if (i == m_RegisteredEvents.Size() - 1) {
-				EN_WARN("EventeSystem::RegisterEvent could not register the event because no slots were available.");
-				return false;
-			}
-		}
-		return true;
+EventListenerHandle EventSystem::RegisterEvent(const void* sender, EventType type, pfnOnEvent callback) {
+	EventListenerHandle handle{};
+	if (!callback || type >= EVENT_TYPE_MAX) {
+		EN_WARN("EventSystem::RegisterEvent was called with invalid event or no valid callback was provided.");
+		return handle;
+	}
+	if (m_FreeSlot == INVALID_ID) {
+		EN_WARN("EventSystem::RegisterEvent could not register the event because no slots were available.");
+		return handle;
+	}
+
+	unsigned int slotIndex = m_FreeSlot;
+	EventListenerSlot& slot = m_Slots[slotIndex];
+	m_FreeSlot = slot.s_NextFree;
+	slot.s_InUse = true;
+	slot.s_Type = type;
+#ifdef EVENT_INSTRUMENTATION
+	// The slot may have belonged to another listener earlier in the frame
+	m_ListenerStats[0][slotIndex] = {};
+	m_ListenerStats[1][slotIndex] = {};
+#endif
+
+	RegisteredEvent e(sender, type, std::move(callback));
+	e.SetID(slotIndex);
+	if (m_DispatchDepth > 0) {
+		slot.s_Pending = true;
+		slot.s_Index = (unsigned int)m_PendingListeners.Size();
+		m_PendingListeners.PushBack(std::move(e));
 	}
 	else {
-		EN_WARN("EventSystem::RegisterEvent was called with invalid event or no valid callback was provided.");
+		slot.s_Pending = false;
+		slot.s_Index = (unsigned int)m_Listeners[type].Size();
+		m_Listeners[type].PushBack(std::move(e));
+	}
+
+	handle.s_Slot = slotIndex;
+	handle.s_Generation = slot.s_Generation;
+	return handle;
+}
+
+bool EventSystem::UnregisterEvent(EventListenerHandle handle) {
+	EventListenerSlot* slot = getSlot(handle);
+	if (!slot) {
+		EN_WARN("EventSystem::UnregisterEvent was called with a stale or invalid handle.");
 		return false;
 	}
+	// The handle is dead from here on, even if the entry is compacted later
+	slot->s_Generation++;
+
+	if (slot->s_Pending) {
+		// Never made it into a bucket, flushPending drops it and frees the slot
+		m_PendingListeners[slot->s_Index].SetRemoved(true);
+		return true;
+	}
+	if (m_DispatchDepth > 0) {
+		// Moving listeners now would skip or repeat some in the running dispatch
+		m_Listeners[slot->s_Type][slot->s_Index].SetRemoved(true);
+		m_PendingRemovals.PushBack(handle.s_Slot);
+		return true;
+	}
+	removeListener(handle.s_Slot);
+	return true;
+}
+
+bool EventSystem::IsRegistered(EventListenerHandle handle) {
+	return getSlot(handle) != nullptr;
+}
+
+EventListenerSlot* EventSystem::getSlot(EventListenerHandle handle) {
+	if (handle.s_Slot >= MAX_REGISTERED_EVENT_CALLBACKS) {
+		return nullptr;
+	}
+	EventListenerSlot& slot = m_Slots[handle.s_Slot];
+	if (!slot.s_InUse || slot.s_Generation != handle.s_Generation) {
+		return nullptr;
+	}
+	return &slot;
+}
+
+void EventSystem::removeListener(unsigned int slotIndex) {
+	EventListenerSlot& slot = m_Slots[slotIndex];
+	DArray<RegisteredEvent, EVENT_LISTENER_INLINE_CAPACITY>& listeners = m_Listeners[slot.s_Type];
+	unsigned int last = (unsigned int)listeners.Size() - 1;
+	if (slot.s_Index != last) {
+		listeners[slot.s_Index] = std::move(listeners[last]);
+		m_Slots[listeners[slot.s_Index].GetID()].s_Index = slot.s_Index;
+	}
+	listeners.PopBack();
+	releaseSlot(slotIndex);
+}
+
+void EventSystem::releaseSlot(unsigned int slotIndex) {
+	EventListenerSlot& slot = m_Slots[slotIndex];
+	slot.s_InUse = false;
+	slot.s_Pending = false;
+	slot.s_NextFree = m_FreeSlot;
+	m_FreeSlot = slotIndex;
 }
 
 void EventSystem::FireEvent(const void* sender, const EventContext& context, EventType type) {
-	if (type != EVENT_TYPE_MAX) {
-		for (int i = 0; i < m_RegisteredEvents.Size(); i++) {
-			// Grab current event for cosmetic code reasons
-			RegisteredEvent e = m_RegisteredEvents[i];
-			// End the loop when it has reached the remaining free slots of the registered event array
-			unsigned int ID = e.GetID();
-			if (e.GetID() == INVALID_ID) {
+	if (type >= EVENT_TYPE_MAX) {
+		EN_ERROR("FireEvent was called with invalid event type.");
+		return;
+	}
+
+	// Listeners are called in place, the bucket does not change until the outermost FireEvent returns
+	m_DispatchDepth++;
+	const DArray<RegisteredEvent, EVENT_LISTENER_INLINE_CAPACITY>& listeners = m_Listeners[type];
+	for (size_t i = 0; i < listeners.Size(); i++) {
+		if (!listeners[i].IsRemoved()) {
+#ifdef EVENT_INSTRUMENTATION
+			// Nested events count towards the handler that fired them as well
+			unsigned int slot = listeners[i].GetID();
+			unsigned long long start = getTimeNs();
+			listeners[i].GetCallback()(sender, context, type);
+			recordHandlerTime(type, slot, getTimeNs() - start);
+#else
+			listeners[i].GetCallback()(sender, context, type);
+#endif
+		}
+	}
+	m_DispatchDepth--;
+
+	if (m_DispatchDepth == 0 && (!m_PendingListeners.Empty() || !m_PendingRemovals.Empty())) {
+		flushPending();
+	}
+}
+
+bool EventSystem::PostEvent(const void* sender, const EventContext& context, EventType type) {
+	if (type >= EVENT_TYPE_MAX) {
+		EN_ERROR("PostEvent was called with invalid event type.");
+		return false;
+	}
+
+	QueuedEvent* slot;
+	unsigned long long position = m_QueueHead.load(std::memory_order_relaxed);
+	for (;;) {
+		slot = &m_Queue[position & (EVENT_QUEUE_CAPACITY - 1)];
+		unsigned long long sequence = slot->s_Sequence.load(std::memory_order_acquire);
+		long long difference = (long long)(sequence - position);
+		if (difference == 0) {
+			if (m_QueueHead.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
 				break;
 			}
-			if (e.GetType() == type && e.GetCallback() != nullptr) {
-				// Get the callback and call it with the appropriate context
-				e.GetCallback()(sender, context, type);
+		}
+		else if (difference < 0) {
+			// The slot still holds an event from one lap ago, the queue is full
+			m_QueueOverflows.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		else {
+			// Another producer claimed this position first
+			position = m_QueueHead.load(std::memory_order_relaxed);
+		}
+	}
+
+	slot->s_Event.s_Sender = sender;
+	slot->s_Event.s_Context = context;
+	slot->s_Event.s_Type = type;
+	slot->s_Sequence.store(position + 1, std::memory_order_release);
+	return true;
+}
+
+void EventSystem::DispatchQueued() {
+	if (m_DispatchDepth > 0) {
+		EN_WARN("EventSystem::DispatchQueued was called from inside an event handler.");
+		return;
+	}
+
+	unsigned long long tail = m_QueueTail.load(std::memory_order_relaxed);
+	unsigned long long end = m_QueueHead.load(std::memory_order_acquire);
+
+	unsigned int depth = (unsigned int)(end - tail);
+	m_LastQueueDepth = depth;
+	if (depth > m_PeakQueueDepth) {
+		m_PeakQueueDepth = depth;
+	}
+
+	unsigned int count = 0;
+	while (tail < end) {
+		QueuedEvent& slot = m_Queue[tail & (EVENT_QUEUE_CAPACITY - 1)];
+		if (slot.s_Sequence.load(std::memory_order_acquire) != tail + 1) {
+			// A producer claimed the slot but is not done writing, pick it up next time
+			break;
+		}
+		m_Batch[count++] = slot.s_Event;
+		// Hand the slot back before firing, so handlers can post again right away
+		slot.s_Sequence.store(tail + EVENT_QUEUE_CAPACITY, std::memory_order_release);
+		tail++;
+	}
+	m_QueueTail.store(tail, std::memory_order_relaxed);
+
+	count = coalesceBatch(count);
+	for (unsigned int i = 0; i < count; i++) {
+		const PostedEvent& event = m_Batch[i];
+		if (m_Replaying && event.s_Type != EVENT_TYPE_WINDOW_CLOSE && event.s_Type != EVENT_TYPE_WINDOW_RESIZE) {
+			// Live input would mix with the recorded one, and the input Input::Update applies
+			// from the records is fired from the records below. The window itself stays live.
+			continue;
+		}
+		if (m_Recording) {
+			recordEvent(event);
+		}
+		FireEvent(event.s_Sender, event.s_Context, event.s_Type);
+	}
+	if (m_Replaying) {
+		fireReplayFrame();
+	}
+
+	unsigned long long overflows = m_QueueOverflows.load(std::memory_order_relaxed);
+	if (overflows != m_ReportedOverflows) {
+		EN_WARN("EventSystem dropped %llu posted events because the queue was full.", overflows - m_ReportedOverflows);
+		m_ReportedOverflows = overflows;
+	}
+}
+
+unsigned int EventSystem::coalesceBatch(unsigned int count) {
+	// Walk backwards so the latest event of each merged type is found first and the
+	// earlier ones fold into it. Merged events take the place of the latest one.
+	unsigned int latest[EVENT_TYPE_MAX];
+	for (int i = 0; i < EVENT_TYPE_MAX; i++) {
+		latest[i] = INVALID_ID;
+	}
+
+	unsigned int kept = count;
+	for (unsigned int i = count; i-- > 0;) {
+		EventType type = m_Batch[i].s_Type;
+		EventCoalescePolicy policy = m_CoalescePolicies[type];
+		if (policy == EVENT_COALESCE_KEEP_ALL) {
+			m_Batch[--kept] = m_Batch[i];
+			continue;
+		}
+		if (latest[type] == INVALID_ID) {
+			latest[type] = --kept;
+			m_Batch[kept] = m_Batch[i];
+			continue;
+		}
+		if (policy == EVENT_COALESCE_ACCUMULATE) {
+			m_Batch[latest[type]].s_Context.u32[0] += m_Batch[i].s_Context.u32[0];
+		}
+		m_Coalesced++;
+	}
+
+	// Kept events were packed towards the end, move them back to the front
+	for (unsigned int i = kept; i < count; i++) {
+		m_Batch[i - kept] = m_Batch[i];
+	}
+	return count - kept;
+}
+
+void EventSystem::SetCoalescePolicy(EventType type, EventCoalescePolicy policy) {
+	if (type >= EVENT_TYPE_MAX || policy >= EVENT_COALESCE_MAX) {
+		EN_WARN("EventSystem::SetCoalescePolicy was called with an invalid type or policy.");
+		return;
+	}
+	m_CoalescePolicies[type] = policy;
+}
+
+EventQueueStats EventSystem::GetQueueStats() {
+	EventQueueStats stats{};
+	stats.s_Posted = m_QueueHead.load(std::memory_order_relaxed);
+	stats.s_Dispatched = m_QueueTail.load(std::memory_order_relaxed);
+	stats.s_Overflows = m_QueueOverflows.load(std::memory_order_relaxed);
+	stats.s_Coalesced = m_Coalesced;
+	stats.s_LastDepth = m_LastQueueDepth;
+	stats.s_PeakDepth = m_PeakQueueDepth;
+	return stats;
+}
+
+void EventSystem::flushPending() {
+	for (unsigned int slot : m_PendingRemovals) {
+		removeListener(slot);
+	}
+	m_PendingRemovals.Clear();
+
+	for (RegisteredEvent& e : m_PendingListeners) {
+		unsigned int slotIndex = e.GetID();
+		if (e.IsRemoved()) {
+			releaseSlot(slotIndex);
+			continue;
+		}
+		EventListenerSlot& slot = m_Slots[slotIndex];
+		slot.s_Pending = false;
+		slot.s_Index = (unsigned int)m_Listeners[slot.s_Type].Size();
+		m_Listeners[slot.s_Type].PushBack(std::move(e));
+	}
+	m_PendingListeners.Clear();
+}
+
+void EventSystem::BeginFrame() {
+	m_Frame++;
+#ifdef EVENT_INSTRUMENTATION
+	m_StatsFrame ^= 1;
+	Memory::ZeroOut(m_TypeStats[m_StatsFrame], sizeof(m_TypeStats[m_StatsFrame]));
+	Memory::ZeroOut(m_ListenerStats[m_StatsFrame], sizeof(m_ListenerStats[m_StatsFrame]));
+	if (m_StatsDumpInterval > 0 && m_Frame % m_StatsDumpInterval == 0) {
+		PrintEventStats();
+	}
+#endif
+	if (!m_Replaying) {
+		return;
+	}
+
+	unsigned int frame = m_Frame - m_ReplayStartFrame;
+	unsigned long long frameNs = 0;
+	m_ReplayFrameEnd = m_ReplayCursor;
+	while (m_ReplayFrameEnd < m_ReplayRecords.Size() && m_ReplayRecords[m_ReplayFrameEnd].s_Frame <= frame) {
+		frameNs = m_ReplayRecords[m_ReplayFrameEnd].s_TimeNs;
+		m_ReplayFrameEnd++;
+	}
+	if (m_ReplayMode == EVENT_REPLAY_ORIGINAL_CADENCE && m_ReplayFrameEnd > m_ReplayCursor) {
+		// The events of a frame were recorded together by DispatchQueued, so the frame waits once
+		unsigned long long now = getTimeNs() - m_ReplayStartNs;
+		if (now < frameNs) {
+			std::this_thread::sleep_for(std::chrono::nanoseconds(frameNs - now));
+		}
+	}
+}
+
+const EventRecord* EventSystem::GetReplayFrame(unsigned int& count) {
+	if (!m_Replaying) {
+		count = 0;
+		return nullptr;
+	}
+	count = (unsigned int)(m_ReplayFrameEnd - m_ReplayCursor);
+	return m_ReplayRecords.Data() + m_ReplayCursor;
+}
+
+void EventSystem::fireReplayFrame() {
+	// Fired after the live batch, at the point of the frame where they were recorded
+	while (m_ReplayCursor < m_ReplayFrameEnd) {
+		// Copied, a handler may stop the replay and release the records
+		EventRecord record = m_ReplayRecords[m_ReplayCursor];
+		m_ReplayCursor++;
+		if (record.s_Type == EVENT_TYPE_WINDOW_RESIZE) {
+			// The renderer has to follow the size of the real window, which comes in live
+			continue;
+		}
+		FireEvent(nullptr, record.s_Context, (EventType)record.s_Type);
+		if (!m_Replaying) {
+			return;
+		}
+	}
+
+	if (m_ReplayCursor == m_ReplayRecords.Size()) {
+		EN_INFO("Event replay finished after %u frames.", m_Frame - m_ReplayStartFrame);
+		StopReplay();
+	}
+}
+
+bool EventSystem::StartRecording(const char* path) {
+	if (m_Recording || m_Replaying) {
+		EN_WARN("EventSystem::StartRecording was called while already recording or replaying.");
+		return false;
+	}
+	if (!m_RecordFile.Open(path, FILE_MODE_WRITE, true)) {
+		return false;
+	}
+
+	EventLogHeader header{ EVENT_LOG_MAGIC, EVENT_LOG_VERSION, sizeof(EventRecord), 0 };
+	if (!m_RecordFile.Write(&header, sizeof(header))) {
+		m_RecordFile.Close();
+		return false;
+	}
+	m_Recording = true;
+	m_RecordCount = 0;
+	m_RecordStartFrame = m_Frame;
+	m_RecordStartNs = getTimeNs();
+	EN_INFO("Recording events to '%s'.", path);
+	return true;
+}
+
+void EventSystem::StopRecording() {
+	if (!m_Recording) {
+		return;
+	}
+	flushRecords();
+	m_RecordFile.Close();
+	m_Recording = false;
+}
+
+bool EventSystem::StartReplay(const char* path, EventReplayMode mode) {
+	if (m_Recording || m_Replaying) {
+		EN_WARN("EventSystem::StartReplay was called while already recording or replaying.");
+		return false;
+	}
+
+	File file;
+	if (!file.Open(path, FILE_MODE_READ, true)) {
+		return false;
+	}
+	unsigned int size = file.Size();
+	EventLogHeader header{};
+	if (size < sizeof(header) || (size - sizeof(header)) % sizeof(EventRecord) != 0) {
+		EN_ERROR("'%s' is not a valid event log, its size does not match the record size.", path);
+		file.Close();
+		return false;
+	}
+
+	// Header and records are read in one go, the log is small next to a frame's worth of assets
+	DArray<char> bytes;
+	bytes.Resize(size);
+	bool read = file.ReadAllBytes(bytes.Data());
+	file.Close();
+	if (!read) {
+		EN_ERROR("Cannot read event log '%s'.", path);
+		return false;
+	}
+	Memory::Copy(&header, bytes.Data(), sizeof(header));
+	if (header.s_Magic != EVENT_LOG_MAGIC || header.s_Version != EVENT_LOG_VERSION || header.s_RecordSize != sizeof(EventRecord)) {
+		EN_ERROR("'%s' is not an event log of version %u.", path, EVENT_LOG_VERSION);
+		return false;
+	}
+
+	size_t count = (size - sizeof(header)) / sizeof(EventRecord);
+	m_ReplayRecords.Resize(count);
+	Memory::Copy(m_ReplayRecords.Data(), bytes.Data() + sizeof(header), count * sizeof(EventRecord));
+	for (size_t i = 0; i < count; i++) {
+		if (m_ReplayRecords[i].s_Type >= EVENT_TYPE_MAX) {
+			EN_ERROR("'%s' contains an invalid event type at record %llu.", path, (unsigned long long)i);
+			m_ReplayRecords = DArray<EventRecord>();
+			return false;
+		}
+	}
+
+	m_Replaying = true;
+	m_ReplayMode = mode;
+	m_ReplayCursor = 0;
+	m_ReplayFrameEnd = 0;
+	m_ReplayStartFrame = m_Frame;
+	m_ReplayStartNs = getTimeNs();
+	EN_INFO("Replaying %llu events from '%s'.", (unsigned long long)count, path);
+	return true;
+}
+
+void EventSystem::StopReplay() {
+	m_Replaying = false;
+	m_ReplayRecords = DArray<EventRecord>();
+	m_ReplayCursor = 0;
+	m_ReplayFrameEnd = 0;
+}
+
+#ifdef EVENT_INSTRUMENTATION
+static const EventHandlerStats s_NoStats{};
+
+const EventHandlerStats& EventSystem::GetTypeStats(EventType type) {
+	if ((unsigned int)type >= EVENT_TYPE_MAX) {
+		return s_NoStats;
+	}
+	return m_TypeStats[m_StatsFrame ^ 1][type];
+}
+
+const EventHandlerStats& EventSystem::GetListenerStats(EventListenerHandle handle) {
+	if (!getSlot(handle)) {
+		return s_NoStats;
+	}
+	return m_ListenerStats[m_StatsFrame ^ 1][handle.s_Slot];
+}
+
+void EventSystem::recordHandlerTime(EventType type, unsigned int slot, unsigned long long ns) {
+	EventHandlerStats* stats[2] = { &m_TypeStats[m_StatsFrame][type], &m_ListenerStats[m_StatsFrame][slot] };
+	for (EventHandlerStats* s : stats) {
+		s->s_Invocations++;
+		s->s_TotalNs += ns;
+		if (ns > s->s_MaxNs) {
+			s->s_MaxNs = ns;
+		}
+	}
+	if (ns > m_HandlerBudgetNs) {
+		stats[0]->s_SlowInvocations++;
+		// One warning per listener and frame, the table has the rest
+		if (stats[1]->s_SlowInvocations++ == 0) {
+			EN_WARN("Event handler %u for %s took %.3f ms, the budget is %.3f ms.",
+				slot, m_EventTypeStrings[type], ns / 1000000.0, m_HandlerBudgetNs / 1000000.0);
+		}
+	}
+}
+
+void EventSystem::PrintEventStats() {
+	unsigned int last = m_StatsFrame ^ 1;
+	EN_INFO("Event handlers in frame %u, budget %.3f ms:", m_Frame - 1, m_HandlerBudgetNs / 1000000.0);
+	for (unsigned int type = 0; type < EVENT_TYPE_MAX; type++) {
+		const EventHandlerStats& typeStats = m_TypeStats[last][type];
+		if (typeStats.s_Invocations == 0) {
+			continue;
+		}
+		EN_INFO("%-26s %6llu calls, %9.3f ms total, %9.3f ms max, %llu slow",
+			m_EventTypeStrings[type],
+			typeStats.s_Invocations,
+			typeStats.s_TotalNs / 1000000.0,
+			typeStats.s_MaxNs / 1000000.0,
+			typeStats.s_SlowInvocations);
+		for (const RegisteredEvent& e : m_Listeners[type]) {
+			const EventHandlerStats& stats = m_ListenerStats[last][e.GetID()];
+			if (stats.s_Invocations == 0) {
+				continue;
 			}
+			EN_INFO("    listener %-3u %6llu calls, %9.3f ms total, %9.3f ms max, %llu slow%s",
+				e.GetID(),
+				stats.s_Invocations,
+				stats.s_TotalNs / 1000000.0,
+				stats.s_MaxNs / 1000000.0,
+				stats.s_SlowInvocations,
+				stats.s_SlowInvocations > 0 ? " <- over budget" : "");
 		}
 	}
-	else {
-		EN_ERROR("FireEvent was called with invalid event type.");
+}
+#endif
+
+void EventSystem::recordEvent(const PostedEvent& event) {
+	EventRecord& record = m_RecordBuffer[m_RecordCount++];
+	record.s_Frame = m_Frame - m_RecordStartFrame;
+	record.s_Type = event.s_Type;
+	record.s_TimeNs = getTimeNs() - m_RecordStartNs;
+	record.s_Context = event.s_Context;
+	if (m_RecordCount == EVENT_RECORD_BUFFER_SIZE && !flushRecords()) {
+		EN_ERROR("Event recording stopped, the log could not be written.");
+		m_RecordFile.Close();
+		m_Recording = false;
 	}
 }
 
+bool EventSystem::flushRecords() {
+	bool written = m_RecordFile.Write(m_RecordBuffer, (unsigned long long)m_RecordCount * sizeof(EventRecord));
+	m_RecordCount = 0;
+	return written;
+}
+
+unsigned long long EventSystem::getTimeNs() {
+	return (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 void EventSystem::Shutdown() {
-	// Invalidate all entries and destroying the array
-	for (int i = 0; i < m_RegisteredEvents.Size(); i++) {
-		m_RegisteredEvents[i].SetID(INVALID_ID);
+	StopRecording();
+	StopReplay();
+
+	// The buckets are statics, their memory has to go back before Memory shuts down
+	for (int i = 0; i < EVENT_TYPE_MAX; i++) {
+		m_Listeners[i] = DArray<RegisteredEvent, EVENT_LISTENER_INLINE_CAPACITY>();
 	}
-	// Destructor of array will be called automatically when exiting the application
-}
\ No newline at end of file
+	m_PendingListeners = DArray<RegisteredEvent>();
+	m_PendingRemovals = DArray<unsigned int>();
+}
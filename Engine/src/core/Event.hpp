@@ -1,7 +1,10 @@
 #pragma once
-#include <functional>
+#include <atomic>
 
-#include "containers/Array.hpp"
+#include "Defines.hpp"
+#include "Delegate.hpp"
+#include "File.hpp"
+#include "containers/DArray.hpp"
 
 enum EventType {
 	EVENT_TYPE_MOUSE_MOVED,
@@ -18,6 +21,13 @@ enum EventType {
 	EVENT_TYPE_MAX,
 };
 
+// Handler counts and timings, debug builds only
+#ifdef _DEBUG
+#define EVENT_INSTRUMENTATION
+#endif
+// Handlers running longer than this are counted as slow and reported
+#define EVENT_DEFAULT_HANDLER_BUDGET_NS (500ULL * 1000)
+
 // Structure to fill out event data 
 
 union EventContext {
@@ -29,9 +39,21 @@ union EventContext {
 };
 
 //typedef bool (*pfnOnEvent)(const void* sender, EventContext context, EventType type);
-typedef std::function<bool(const void* sender, EventContext context, EventType type)> pfnOnEvent;
+// Captures up to DELEGATE_DEFAULT_CAPACITY bytes, registering and calling never allocates
+typedef Delegate<bool(const void* sender, EventContext context, EventType type)> pfnOnEvent;
 
 #define MAX_REGISTERED_EVENT_CALLBACKS 512
+// Listeners of one type that fit in the bucket before it allocates
+#define EVENT_LISTENER_INLINE_CAPACITY 4
+// Events that can be posted between two dispatches, has to be a power of two
+#define EVENT_QUEUE_CAPACITY 1024
+
+// Returned by RegisterEvent. The generation changes every time the slot is reused,
+// so a stale handle can never remove someone else's listener.
+struct EventListenerHandle {
+	unsigned int s_Slot = INVALID_ID;
+	unsigned int s_Generation = 0;
+};
 
 class RegisteredEvent {
 public:
@@ -39,28 +61,230 @@ public:
 	RegisteredEvent(const void* sender, EventType type, pfnOnEvent callback);
 
 	//Getters and setters
+	// The ID is the handle slot of the listener
 	const int GetID() const { return m_ID; }
 	void SetID(unsigned int id) { m_ID = id; }
 
-	const pfnOnEvent GetCallback() const { return m_Callback; }
-	void SetCallback(pfnOnEvent callback) { m_Callback = callback; }
+	const pfnOnEvent& GetCallback() const { return m_Callback; }
+	void SetCallback(pfnOnEvent callback) { m_Callback = std::move(callback); }
 
 	const EventType GetType() const { return m_Type; }
 	void SetType(EventType type) { m_Type = type; }
+
+	// Unregistered during a dispatch, skipped until it is compacted away
+	bool IsRemoved() const { return m_Removed; }
+	void SetRemoved(bool removed) { m_Removed = removed; }
 private:
 	unsigned int m_ID;
 	pfnOnEvent m_Callback;
 	EventType m_Type;
+	bool m_Removed = false;
+};
+
+// Where the listener behind a handle lives right now
+struct EventListenerSlot {
+	unsigned int s_Generation;
+	// Position in the type's bucket, or in the pending list while s_Pending is set
+	unsigned int s_Index;
+	unsigned int s_NextFree;
+	EventType s_Type;
+	bool s_InUse;
+	bool s_Pending;
+};
+
+// How posted events of one type are merged before a dispatch
+enum EventCoalescePolicy {
+	// Every event is fired
+	EVENT_COALESCE_KEEP_ALL,
+	// Only the latest event of the batch is fired
+	EVENT_COALESCE_KEEP_LAST,
+	// The latest event is fired with the u32[0] values of the whole batch summed up
+	EVENT_COALESCE_ACCUMULATE,
+
+	EVENT_COALESCE_MAX,
 };
 
+struct PostedEvent {
+	const void* s_Sender;
+	EventContext s_Context;
+	EventType s_Type;
+};
+
+// Slot in the posted event ring. The sequence tells producers and the consumer whose
+// turn it is, so posting never takes a lock.
+struct alignas(64) QueuedEvent {
+	std::atomic<unsigned long long> s_Sequence;
+	PostedEvent s_Event;
+};
+
+enum EventReplayMode {
+	// Every event waits for the time it was recorded at, relative to the start
+	EVENT_REPLAY_ORIGINAL_CADENCE,
+	// Events still arrive in the frame they were recorded in, but nothing waits
+	EVENT_REPLAY_AS_FAST_AS_POSSIBLE,
+};
+
+// Binary event log: one EventLogHeader followed by EventRecords in firing order
+#define EVENT_LOG_MAGIC 0x474C5645 // "EVLG"
+#define EVENT_LOG_VERSION 1
+// Records buffered before they are written out
+#define EVENT_RECORD_BUFFER_SIZE 1024
+
+struct EventLogHeader {
+	unsigned int s_Magic;
+	unsigned int s_Version;
+	unsigned int s_RecordSize;
+	unsigned int s_Reserved;
+};
+
+struct EventRecord {
+	// Frames and nanoseconds since the recording started
+	unsigned int s_Frame;
+	unsigned int s_Type;
+	unsigned long long s_TimeNs;
+	EventContext s_Context;
+};
+static_assert(sizeof(EventRecord) == 32, "EventRecord is part of the event log format.");
+
+// Handler calls of one event type or one listener within a frame
+struct EventHandlerStats {
+	unsigned long long s_Invocations;
+	unsigned long long s_TotalNs;
+	unsigned long long s_MaxNs;
+	unsigned long long s_SlowInvocations;
+};
+
+struct EventQueueStats {
+	unsigned long long s_Posted;
+	unsigned long long s_Dispatched;
+	// Events dropped because the queue was full
+	unsigned long long s_Overflows;
+	// Events merged into a later one of the same type by the coalescing policy
+	unsigned long long s_Coalesced;
+	// Queue depth at the start of the last dispatch and the highest seen so far
+	unsigned int s_LastDepth;
+	unsigned int s_PeakDepth;
+};
+
+// RegisterEvent, FireEvent and DispatchQueued belong to the main thread,
+// PostEvent can be called from any thread
 class EventSystem final{
 public:
 	static bool Initialize();
-	static bool RegisterEvent(const void* sender, EventType type, pfnOnEvent callback);
+	// Returns a handle with s_Slot INVALID_ID if the listener could not be registered
+	static EventListenerHandle RegisterEvent(const void* sender, EventType type, pfnOnEvent callback);
+	// O(1), the last listener of the type moves into the gap so buckets stay dense
+	static bool UnregisterEvent(EventListenerHandle handle);
+	static bool IsRegistered(EventListenerHandle handle);
 	static void FireEvent(const void* sender, const EventContext& context, EventType type);
+	// Queues the event for the next DispatchQueued, returns false if the queue is full
+	static bool PostEvent(const void* sender, const EventContext& context, EventType type);
+	// Fires everything posted before the call, events posted by the handlers wait for the next one
+	static void DispatchQueued();
+	// Merging is per type, regardless of the sender. Only applies to posted events.
+	static void SetCoalescePolicy(EventType type, EventCoalescePolicy policy);
+
+	// Advances the frame index, call once per frame before Input::Update and DispatchQueued.
+	// While replaying this picks the recorded events of the frame, Input::Update applies
+	// their input and DispatchQueued fires them where they were recorded.
+	static void BeginFrame();
+
+	// Records every event that DispatchQueued fires, which is all window and input events.
+	// Events fired directly are left out, the code that fires them does so again on replay.
+	static bool StartRecording(const char* path);
+	static void StopRecording();
+	// Posted events are dropped during a replay, except window close and resize, and Input
+	// ignores live samples. Recorded resizes are skipped instead, the renderer follows the real window.
+	static bool StartReplay(const char* path, EventReplayMode mode);
+	static void StopReplay();
+	static bool IsRecording() { return m_Recording; }
+	static bool IsReplaying() { return m_Replaying; }
+	// Recorded events of the current frame, none unless replaying
+	static const EventRecord* GetReplayFrame(unsigned int& count);
+
+#ifdef EVENT_INSTRUMENTATION
+	static void SetHandlerBudget(unsigned long long ns) { m_HandlerBudgetNs = ns; }
+	// Prints the table every that many frames, 0 turns it off
+	static void SetStatsDumpInterval(unsigned int frames) { m_StatsDumpInterval = frames; }
+	// Handler table of the last completed frame, per type and per listener
+	static void PrintEventStats();
+	// Zeroed stats for an invalid type or a handle that is no longer registered
+	static const EventHandlerStats& GetTypeStats(EventType type);
+	static const EventHandlerStats& GetListenerStats(EventListenerHandle handle);
+#else
+	static void SetHandlerBudget(unsigned long long ns) {}
+	static void SetStatsDumpInterval(unsigned int frames) {}
+	static void PrintEventStats() {}
+#endif
 	static void Shutdown();
-	static Array<RegisteredEvent, MAX_REGISTERED_EVENT_CALLBACKS> GetRegisteredEvents() { return m_RegisteredEvents; }
-	static Array<RegisteredEvent, MAX_REGISTERED_EVENT_CALLBACKS> m_RegisteredEvents;
+
+	static EventQueueStats GetQueueStats();
+
+	// Includes listeners that were unregistered during the running dispatch
+	static unsigned int GetListenerCount(EventType type) { return type < EVENT_TYPE_MAX ? (unsigned int)m_Listeners[type].Size() : 0; }
 private:
-	static unsigned int m_IDCounter;
+	// Applies registrations and removals made during a dispatch once no FireEvent is running anymore
+	static void flushPending();
+	// Applies the coalescing policies to the first count events of m_Batch, returns how many are left
+	static unsigned int coalesceBatch(unsigned int count);
+#ifdef EVENT_INSTRUMENTATION
+	static void recordHandlerTime(EventType type, unsigned int slot, unsigned long long ns);
+#endif
+	static void recordEvent(const PostedEvent& event);
+	static void fireReplayFrame();
+	static bool flushRecords();
+	static unsigned long long getTimeNs();
+	static void removeListener(unsigned int slot);
+	static void releaseSlot(unsigned int slot);
+	static EventListenerSlot* getSlot(EventListenerHandle handle);
+
+	// One contiguous bucket per type, so firing an event only touches its own listeners
+	static DArray<RegisteredEvent, EVENT_LISTENER_INLINE_CAPACITY> m_Listeners[EVENT_TYPE_MAX];
+	// Listeners registered from inside a callback. Adding them right away could move
+	// the bucket, and the callback that is running with it.
+	static DArray<RegisteredEvent> m_PendingListeners;
+	// Slots of listeners unregistered during a dispatch
+	static DArray<unsigned int> m_PendingRemovals;
+	static EventListenerSlot m_Slots[MAX_REGISTERED_EVENT_CALLBACKS];
+	static unsigned int m_FreeSlot;
+	static unsigned int m_DispatchDepth;
+
+	static QueuedEvent m_Queue[EVENT_QUEUE_CAPACITY];
+	// Events of the running DispatchQueued, copied out so their slots free up right away
+	static PostedEvent m_Batch[EVENT_QUEUE_CAPACITY];
+	static EventCoalescePolicy m_CoalescePolicies[EVENT_TYPE_MAX];
+	static unsigned long long m_Coalesced;
+
+	static unsigned int m_Frame;
+	static bool m_Recording;
+	static File m_RecordFile;
+	static EventRecord m_RecordBuffer[EVENT_RECORD_BUFFER_SIZE];
+	static unsigned int m_RecordCount;
+	static unsigned int m_RecordStartFrame;
+	static unsigned long long m_RecordStartNs;
+	static bool m_Replaying;
+	static EventReplayMode m_ReplayMode;
+	static DArray<EventRecord> m_ReplayRecords;
+	static size_t m_ReplayCursor;
+	// End of the records picked by BeginFrame
+	static size_t m_ReplayFrameEnd;
+	static unsigned int m_ReplayStartFrame;
+	static unsigned long long m_ReplayStartNs;
+
+#ifdef EVENT_INSTRUMENTATION
+	static const char* m_EventTypeStrings[EVENT_TYPE_MAX];
+	// Two frames of stats, the running one and the last completed one
+	static EventHandlerStats m_TypeStats[2][EVENT_TYPE_MAX];
+	static EventHandlerStats m_ListenerStats[2][MAX_REGISTERED_EVENT_CALLBACKS];
+	static unsigned int m_StatsFrame;
+	static unsigned long long m_HandlerBudgetNs;
+	static unsigned int m_StatsDumpInterval;
+#endif
+	// Producers claim slots at the head, the main thread drains from the tail
+	alignas(64) static std::atomic<unsigned long long> m_QueueHead;
+	alignas(64) static std::atomic<unsigned long long> m_QueueTail;
+	static std::atomic<unsigned long long> m_QueueOverflows;
+	static unsigned long long m_ReportedOverflows;
+	static unsigned int m_LastQueueDepth;
+	static unsigned int m_PeakQueueDepth;
 };
\ No newline at end of file
@@ -0,0 +1,200 @@
+#pragma once
+#include <type_traits>
+
+#include "Event.hpp"
+#include "Logger.hpp"
+
+// Listener slots of one channel, they live inline so subscribing never allocates
+#define EVENT_CHANNEL_DEFAULT_LISTENERS 16
+
+// Typed events: every event is its own struct, passed by reference, so payloads of any
+// size travel without going through EventContext or the heap. Both channels below are
+// synchronous and belong to the main thread, cross thread events go through
+// EventSystem::PostEvent and reach typed listeners with EventChannel::Bridge.
+
+// Listeners fixed at compile time. Fire expands to one direct call per listener,
+// which the compiler can inline. Listeners have to be plain or static member functions,
+// so it fits handlers that need no instance, like the key logging of the Application.
+template<typename Event, auto... Listeners>
+class EventDispatcher {
+public:
+	static_assert((std::is_invocable<decltype(Listeners), const Event&>::value && ...), "Every listener has to take a const reference to the event.");
+
+	static void Fire(const Event& event) {
+		(Listeners(event), ...);
+	}
+
+	// Same as EventChannel::Bridge, the one runtime call lands in the fixed listeners
+	static EventListenerHandle Bridge() {
+		return EventSystem::RegisterEvent(nullptr, Event::Type, [](const void*, EventContext context, EventType) {
+			Fire(Event::FromContext(context));
+			return true;
+		});
+	}
+};
+
+// Listeners added at runtime, one set per event struct
+template<typename Event, size_t MaxListeners = EVENT_CHANNEL_DEFAULT_LISTENERS>
+class EventChannel {
+public:
+	typedef Delegate<bool(const Event& event)> Listener;
+
+	// Returns an ID for Unsubscribe, INVALID_ID if the channel is full
+	static unsigned int Subscribe(Listener listener) {
+		if (!listener || m_Count == MaxListeners) {
+			EN_WARN("EventChannel::Subscribe was called without a listener or the channel is full.");
+			return INVALID_ID;
+		}
+		m_Listeners[m_Count] = std::move(listener);
+		m_IDs[m_Count] = m_NextID;
+		m_Count++;
+		return m_NextID++;
+	}
+
+	static bool Unsubscribe(unsigned int id) {
+		for (unsigned int i = 0; i < m_Count; i++) {
+			if (m_IDs[i] != id) {
+				continue;
+			}
+			if (m_FireDepth > 0) {
+				// The listener may be the one running, compact once Fire is done
+				m_IDs[i] = INVALID_ID;
+				m_HasRemoved = true;
+			}
+			else {
+				removeAt(i);
+			}
+			return true;
+		}
+		return false;
+	}
+
+	static void Fire(const Event& event) {
+		m_FireDepth++;
+		// Slots never move while firing, listeners subscribed by a listener are called as well
+		for (unsigned int i = 0; i < m_Count; i++) {
+			if (m_IDs[i] != INVALID_ID) {
+				m_Listeners[i](event);
+			}
+		}
+		m_FireDepth--;
+
+		if (m_FireDepth == 0 && m_HasRemoved) {
+			for (unsigned int i = m_Count; i-- > 0;) {
+				if (m_IDs[i] == INVALID_ID) {
+					removeAt(i);
+				}
+			}
+			m_HasRemoved = false;
+		}
+	}
+
+	static void Clear() {
+		for (unsigned int i = 0; i < m_Count; i++) {
+			m_Listeners[i] = nullptr;
+		}
+		m_Count = 0;
+	}
+
+	static unsigned int GetListenerCount() { return m_Count; }
+
+	// Subscribes the channel to Event::Type on the EventType path, so posted and coalesced
+	// events reach the typed listeners. The event struct decodes the context itself.
+	static EventListenerHandle Bridge() {
+		return EventSystem::RegisterEvent(nullptr, Event::Type, [](const void*, EventContext context, EventType) {
+			Fire(Event::FromContext(context));
+			return true;
+		});
+	}
+private:
+	// Swap-remove, listener order is not kept
+	static void removeAt(unsigned int index) {
+		m_Count--;
+		if (index != m_Count) {
+			m_Listeners[index] = std::move(m_Listeners[m_Count]);
+			m_IDs[index] = m_IDs[m_Count];
+		}
+		m_Listeners[m_Count] = nullptr;
+	}
+
+	inline static Listener m_Listeners[MaxListeners];
+	inline static unsigned int m_IDs[MaxListeners];
+	inline static unsigned int m_Count = 0;
+	inline static unsigned int m_NextID = 0;
+	inline static unsigned int m_FireDepth = 0;
+	inline static bool m_HasRemoved = false;
+};
+
+// Typed views of the EventType events, in the layout Platform and Input fill the context
+
+struct WindowResizeEvent {
+	static constexpr EventType Type = EVENT_TYPE_WINDOW_RESIZE;
+	unsigned int s_Width;
+	unsigned int s_Height;
+
+	static WindowResizeEvent FromContext(const EventContext& context) { return { (unsigned int)context.u32[0], (unsigned int)context.u32[1] }; }
+};
+
+struct WindowCloseEvent {
+	static constexpr EventType Type = EVENT_TYPE_WINDOW_CLOSE;
+
+	static WindowCloseEvent FromContext(const EventContext&) { return {}; }
+};
+
+struct WindowMovedEvent {
+	static constexpr EventType Type = EVENT_TYPE_WINDOW_MOVED;
+	int s_X;
+	int s_Y;
+
+	static WindowMovedEvent FromContext(const EventContext& context) { return { context.u32[0], context.u32[1] }; }
+};
+
+struct MouseMovedEvent {
+	static constexpr EventType Type = EVENT_TYPE_MOUSE_MOVED;
+	int s_X;
+	int s_Y;
+
+	static MouseMovedEvent FromContext(const EventContext& context) { return { context.u32[0], context.u32[1] }; }
+};
+
+struct MouseScrolledEvent {
+	static constexpr EventType Type = EVENT_TYPE_MOUSE_SCROLLED;
+	// Summed over the frame, 120 per wheel notch
+	int s_Delta;
+	int s_X;
+	int s_Y;
+
+	static MouseScrolledEvent FromContext(const EventContext& context) { return { context.u32[0], context.u32[1], context.u32[2] }; }
+};
+
+struct MouseClickedEvent {
+	static constexpr EventType Type = EVENT_TYPE_MOUSE_CLICKED;
+	// MouseCode
+	unsigned int s_Button;
+
+	static MouseClickedEvent FromContext(const EventContext& context) { return { (unsigned int)context.u32[0] }; }
+};
+
+struct MouseReleasedEvent {
+	static constexpr EventType Type = EVENT_TYPE_MOUSE_RELEASED;
+	// MouseCode
+	unsigned int s_Button;
+
+	static MouseReleasedEvent FromContext(const EventContext& context) { return { (unsigned int)context.u32[0] }; }
+};
+
+struct KeyPressedEvent {
+	static constexpr EventType Type = EVENT_TYPE_KEY_PRESSED;
+	// KeyCode
+	unsigned int s_Code;
+
+	static KeyPressedEvent FromContext(const EventContext& context) { return { (unsigned int)context.u32[0] }; }
+};
+
+struct KeyReleasedEvent {
+	static constexpr EventType Type = EVENT_TYPE_KEY_RELEASED;
+	// KeyCode
+	unsigned int s_Code;
+
+	static KeyReleasedEvent FromContext(const EventContext& context) { return { (unsigned int)context.u32[0] }; }
+};
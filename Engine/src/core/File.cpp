@@ -5,7 +5,8 @@
 bool File::Open(const char* path, FileMode mode, bool isBinary)
 {
 	const char* modeString;
-	if (this->Exists(path)) {
+	// Files opened for writing are created
+	if ((mode & FILE_MODE_WRITE) != 0 || this->Exists(path)) {
 		m_Path = path;
 		if ((mode & FILE_MODE_READ) != 0 && (mode & FILE_MODE_WRITE) != 0) {
 			modeString = isBinary ? "w+b" : "w+";
@@ -46,8 +47,10 @@ bool File::Open(const char* path, FileMode mode, bool isBinary)
 
 bool File::ReadAllBytes(char* buffer) {
 	if (m_isOpen) {
-		fread(buffer, 1, m_Size, m_Handle);
-
+		if (fread(buffer, 1, m_Size, m_Handle) != m_Size) {
+			EN_ERROR("Could not read all %u bytes of file: %s.", m_Size, m_Path);
+			return false;
+		}
 		return true;
 	}
 	else {
@@ -56,12 +59,31 @@ bool File::ReadAllBytes(char* buffer) {
 	}
 }
 
+bool File::Write(const void* data, unsigned long long size) {
+	if (!m_isOpen) {
+		EN_ERROR("Tried to write to file that has not been opened. Open file first: %s.", m_Path);
+		return false;
+	}
+	if (fwrite(data, 1, (size_t)size, m_Handle) != size) {
+		EN_ERROR("Could not write %llu bytes to file: %s.", size, m_Path);
+		return false;
+	}
+	return true;
+}
+
+void File::Flush() {
+	if (m_Handle) {
+		fflush(m_Handle);
+	}
+}
+
 void File::Close()
 {
 	if (m_Handle) {
 		fclose(m_Handle);
 		m_Handle = 0;
 	}
+	m_isOpen = false;
 }
 
 bool File::Exists(const char* path)
@@ -15,6 +15,9 @@ public:
 	unsigned int Size() { return m_Size; }
 
 	bool ReadAllBytes(char* buffer);
+	bool Write(const void* data, unsigned long long size);
+	// Hands buffered writes to the operating system
+	void Flush();
 
 	static bool Exists(const char* path);
 private:
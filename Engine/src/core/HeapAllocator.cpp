@@ -0,0 +1,311 @@
+#include <intrin.h>
+
+#include "HeapAllocator.hpp"
+#include "Logger.hpp"
+
+// Every block starts with this header. The free list links overlap the payload
+// and are only valid while the block is free.
+struct HeapBlock {
+	HeapBlock* s_PrevPhysical;
+	// Payload size, the lowest bit marks the block as free
+	unsigned long long s_Size;
+
+	HeapBlock* s_NextFree;
+	HeapBlock* s_PrevFree;
+};
+
+#define HEAP_BLOCK_HEADER_SIZE (2 * sizeof(void*))
+#define HEAP_BLOCK_MIN_SIZE (2 * sizeof(void*))
+#define HEAP_BLOCK_FREE_BIT 1ULL
+
+static int findLastSet(unsigned long long value) {
+	unsigned long index;
+	return _BitScanReverse64(&index, value) ? (int)index : -1;
+}
+
+static int findFirstSet(unsigned int value) {
+	unsigned long index;
+	return _BitScanForward(&index, value) ? (int)index : -1;
+}
+
+static unsigned long long blockSize(const HeapBlock* block) { return block->s_Size & ~HEAP_BLOCK_FREE_BIT; }
+static bool blockIsFree(const HeapBlock* block) { return (block->s_Size & HEAP_BLOCK_FREE_BIT) != 0; }
+static char* blockPayload(HeapBlock* block) { return (char*)block + HEAP_BLOCK_HEADER_SIZE; }
+static HeapBlock* blockFromPayload(const void* payload) { return (HeapBlock*)((char*)payload - HEAP_BLOCK_HEADER_SIZE); }
+static HeapBlock* blockNextPhysical(HeapBlock* block) { return (HeapBlock*)(blockPayload(block) + blockSize(block)); }
+
+// Maps a block size to the list it is stored in
+static void mappingInsert(unsigned long long size, int& fl, int& sl) {
+	if (size < HEAP_SMALL_BLOCK_SIZE) {
+		fl = 0;
+		sl = (int)(size / (HEAP_SMALL_BLOCK_SIZE / HEAP_SL_INDEX_COUNT));
+	}
+	else {
+		int bit = findLastSet(size);
+		sl = (int)(size >> (bit - HEAP_SL_INDEX_COUNT_LOG2)) ^ HEAP_SL_INDEX_COUNT;
+		fl = bit - (HEAP_FL_INDEX_SHIFT - 1);
+	}
+}
+
+// Rounds the size up to the next list boundary so any block in the found list is large enough
+static void mappingSearch(unsigned long long size, int& fl, int& sl) {
+	if (size >= HEAP_SMALL_BLOCK_SIZE) {
+		size += (1ULL << (findLastSet(size) - HEAP_SL_INDEX_COUNT_LOG2)) - 1;
+	}
+	mappingInsert(size, fl, sl);
+}
+
+bool HeapAllocator::Create(void* memory, unsigned long long size) {
+	if (m_Memory) {
+		EN_WARN("HeapAllocator::Create was called on a heap that is already created.");
+		return false;
+	}
+
+	// Align the start and the size of the region to the heap granularity
+	unsigned long long start = ((unsigned long long)memory + HEAP_ALIGNMENT - 1) & ~(HEAP_ALIGNMENT - 1);
+	size -= start - (unsigned long long)memory;
+	size &= ~(HEAP_ALIGNMENT - 1);
+
+	if (size < 2 * HEAP_BLOCK_HEADER_SIZE + HEAP_BLOCK_MIN_SIZE || size >= (1ULL << HEAP_FL_INDEX_MAX)) {
+		EN_ERROR("HeapAllocator::Create was called with an unsupported size: %llu bytes.", size);
+		return false;
+	}
+
+	m_Memory = (char*)start;
+	m_Capacity = size;
+
+	// One free block spans the whole region, followed by an empty used block
+	// so the last real block never tries to merge past the end of the heap
+	HeapBlock* block = (HeapBlock*)m_Memory;
+	block->s_PrevPhysical = nullptr;
+	block->s_Size = size - 2 * HEAP_BLOCK_HEADER_SIZE;
+
+	HeapBlock* sentinel = blockNextPhysical(block);
+	sentinel->s_PrevPhysical = block;
+	sentinel->s_Size = 0;
+
+	insertFreeBlock(block);
+	return true;
+}
+
+void HeapAllocator::Destroy() {
+	if (m_UsedBlockCount > 0) {
+		EN_WARN("HeapAllocator destroyed with %u blocks (%llu bytes) still allocated.", m_UsedBlockCount, m_UsedBytes);
+	}
+	m_Memory = nullptr;
+	m_Capacity = 0;
+	m_FlBitmap = 0;
+	for (int i = 0; i < HEAP_FL_INDEX_COUNT; i++) {
+		m_SlBitmap[i] = 0;
+		for (int j = 0; j < HEAP_SL_INDEX_COUNT; j++) {
+			m_FreeLists[i][j] = nullptr;
+		}
+	}
+	m_UsedBytes = 0;
+	m_FreeBytes = 0;
+	m_FreeBlockCount = 0;
+	m_UsedBlockCount = 0;
+}
+
+bool HeapAllocator::Extend(unsigned long long size) {
+	size &= ~(HEAP_ALIGNMENT - 1);
+	if (!m_Memory || size < HEAP_BLOCK_HEADER_SIZE + HEAP_BLOCK_MIN_SIZE || m_Capacity + size >= (1ULL << HEAP_FL_INDEX_MAX)) {
+		return false;
+	}
+
+	lock();
+	// The old sentinel becomes the header of a used block spanning the new memory,
+	// and a new sentinel is placed at the new end
+	HeapBlock* block = (HeapBlock*)(m_Memory + m_Capacity - HEAP_BLOCK_HEADER_SIZE);
+	block->s_Size = size - HEAP_BLOCK_HEADER_SIZE;
+	HeapBlock* sentinel = blockNextPhysical(block);
+	sentinel->s_PrevPhysical = block;
+	sentinel->s_Size = 0;
+
+	m_Capacity += size;
+	m_UsedBytes += blockSize(block);
+	m_UsedBlockCount++;
+	unlock();
+
+	// Freeing the block merges it with a free block at the old end of the heap
+	Free(blockPayload(block));
+	return true;
+}
+
+void* HeapAllocator::Allocate(unsigned long long size) {
+	if (!m_Memory) {
+		return nullptr;
+	}
+
+	unsigned long long adjusted = size < HEAP_BLOCK_MIN_SIZE ? HEAP_BLOCK_MIN_SIZE : size;
+	adjusted = (adjusted + HEAP_ALIGNMENT - 1) & ~(HEAP_ALIGNMENT - 1);
+	if (adjusted >= (1ULL << HEAP_FL_INDEX_MAX)) {
+		return nullptr;
+	}
+
+	lock();
+	HeapBlock* block = findFreeBlock(adjusted);
+	if (!block) {
+		unlock();
+		return nullptr;
+	}
+	removeFreeBlock(block);
+
+	// Split off the remainder if it can hold a block of its own
+	unsigned long long remaining = blockSize(block) - adjusted;
+	if (remaining >= HEAP_BLOCK_HEADER_SIZE + HEAP_BLOCK_MIN_SIZE) {
+		HeapBlock* remainder = (HeapBlock*)(blockPayload(block) + adjusted);
+		remainder->s_PrevPhysical = block;
+		remainder->s_Size = remaining - HEAP_BLOCK_HEADER_SIZE;
+		blockNextPhysical(remainder)->s_PrevPhysical = remainder;
+		block->s_Size = adjusted;
+		insertFreeBlock(remainder);
+	}
+	else {
+		block->s_Size = blockSize(block);
+	}
+
+	m_UsedBytes += blockSize(block);
+	m_UsedBlockCount++;
+	unlock();
+	return blockPayload(block);
+}
+
+void HeapAllocator::Free(void* memory) {
+	if (!memory) {
+		return;
+	}
+
+	lock();
+	HeapBlock* block = blockFromPayload(memory);
+	m_UsedBytes -= blockSize(block);
+	m_UsedBlockCount--;
+
+	// Coalesce with the physical neighbours so free memory stays in as few blocks as possible
+	HeapBlock* prev = block->s_PrevPhysical;
+	if (prev && blockIsFree(prev)) {
+		removeFreeBlock(prev);
+		prev->s_Size = blockSize(prev) + HEAP_BLOCK_HEADER_SIZE + blockSize(block);
+		block = prev;
+		blockNextPhysical(block)->s_PrevPhysical = block;
+	}
+
+	HeapBlock* next = blockNextPhysical(block);
+	if (blockIsFree(next)) {
+		removeFreeBlock(next);
+		block->s_Size = blockSize(block) + HEAP_BLOCK_HEADER_SIZE + blockSize(next);
+		blockNextPhysical(block)->s_PrevPhysical = block;
+	}
+
+	insertFreeBlock(block);
+	unlock();
+}
+
+unsigned long long HeapAllocator::GetBlockSize(const void* block) {
+	return blockSize(blockFromPayload(block));
+}
+
+HeapStats HeapAllocator::GetStats() {
+	HeapStats stats{};
+	lock();
+	stats.s_Capacity = m_Capacity;
+	stats.s_UsedBytes = m_UsedBytes;
+	stats.s_FreeBytes = m_FreeBytes;
+	stats.s_FreeBlockCount = m_FreeBlockCount;
+	stats.s_UsedBlockCount = m_UsedBlockCount;
+
+	// The largest free block can only be in the highest non empty list
+	if (m_FlBitmap) {
+		int fl = findLastSet(m_FlBitmap);
+		int sl = findLastSet(m_SlBitmap[fl]);
+		for (HeapBlock* block = m_FreeLists[fl][sl]; block; block = block->s_NextFree) {
+			if (blockSize(block) > stats.s_LargestFreeBlock) {
+				stats.s_LargestFreeBlock = blockSize(block);
+			}
+		}
+	}
+	unlock();
+
+	if (stats.s_FreeBytes > 0) {
+		stats.s_Fragmentation = 1.0f - (float)stats.s_LargestFreeBlock / (float)stats.s_FreeBytes;
+	}
+	return stats;
+}
+
+void HeapAllocator::insertFreeBlock(HeapBlock* block) {
+	int fl, sl;
+	mappingInsert(blockSize(block), fl, sl);
+
+	HeapBlock* head = m_FreeLists[fl][sl];
+	block->s_Size |= HEAP_BLOCK_FREE_BIT;
+	block->s_NextFree = head;
+	block->s_PrevFree = nullptr;
+	if (head) {
+		head->s_PrevFree = block;
+	}
+	m_FreeLists[fl][sl] = block;
+
+	m_FlBitmap |= 1U << fl;
+	m_SlBitmap[fl] |= 1U << sl;
+
+	m_FreeBytes += blockSize(block);
+	m_FreeBlockCount++;
+}
+
+void HeapAllocator::removeFreeBlock(HeapBlock* block) {
+	int fl, sl;
+	mappingInsert(blockSize(block), fl, sl);
+
+	if (block->s_PrevFree) {
+		block->s_PrevFree->s_NextFree = block->s_NextFree;
+	}
+	if (block->s_NextFree) {
+		block->s_NextFree->s_PrevFree = block->s_PrevFree;
+	}
+	if (m_FreeLists[fl][sl] == block) {
+		m_FreeLists[fl][sl] = block->s_NextFree;
+		// Clear the bitmaps once the list runs empty
+		if (!m_FreeLists[fl][sl]) {
+			m_SlBitmap[fl] &= ~(1U << sl);
+			if (!m_SlBitmap[fl]) {
+				m_FlBitmap &= ~(1U << fl);
+			}
+		}
+	}
+	block->s_Size &= ~HEAP_BLOCK_FREE_BIT;
+
+	m_FreeBytes -= blockSize(block);
+	m_FreeBlockCount--;
+}
+
+HeapBlock* HeapAllocator::findFreeBlock(unsigned long long size) {
+	int fl, sl;
+	mappingSearch(size, fl, sl);
+	if (fl >= HEAP_FL_INDEX_COUNT) {
+		return nullptr;
+	}
+
+	// First look for a list of the same first level that is at least as large
+	unsigned int slMap = m_SlBitmap[fl] & (~0U << sl);
+	if (!slMap) {
+		// Otherwise take the smallest list of any larger first level
+		unsigned int flMap = fl + 1 < HEAP_FL_INDEX_COUNT ? m_FlBitmap & (~0U << (fl + 1)) : 0;
+		if (!flMap) {
+			return nullptr;
+		}
+		fl = findFirstSet(flMap);
+		slMap = m_SlBitmap[fl];
+	}
+	sl = findFirstSet(slMap);
+	return m_FreeLists[fl][sl];
+}
+
+void HeapAllocator::lock() {
+	while (m_Lock.test_and_set(std::memory_order_acquire)) {
+		_mm_pause();
+	}
+}
+
+void HeapAllocator::unlock() {
+	m_Lock.clear(std::memory_order_release);
+}
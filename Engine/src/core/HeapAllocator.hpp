@@ -0,0 +1,79 @@
+#pragma once
+#include <atomic>
+
+// Two level segregated fit (TLSF) allocator over one up-front reserved region.
+// Allocate and Free are O(1): free blocks are kept in size class lists that are
+// found through two bitmaps instead of walking the heap.
+
+// Granularity of every allocation
+#define HEAP_ALIGNMENT_LOG2 4
+#define HEAP_ALIGNMENT (1ULL << HEAP_ALIGNMENT_LOG2)
+// Each first level (power of two) range is split into 2^HEAP_SL_INDEX_COUNT_LOG2 lists
+#define HEAP_SL_INDEX_COUNT_LOG2 5
+#define HEAP_SL_INDEX_COUNT (1 << HEAP_SL_INDEX_COUNT_LOG2)
+// Blocks below this size are all kept in the first level 0 lists with linear spacing
+#define HEAP_FL_INDEX_SHIFT (HEAP_SL_INDEX_COUNT_LOG2 + HEAP_ALIGNMENT_LOG2)
+#define HEAP_SMALL_BLOCK_SIZE (1ULL << HEAP_FL_INDEX_SHIFT)
+// Largest supported block is 2^HEAP_FL_INDEX_MAX bytes
+#define HEAP_FL_INDEX_MAX 40
+#define HEAP_FL_INDEX_COUNT (HEAP_FL_INDEX_MAX - HEAP_FL_INDEX_SHIFT + 1)
+
+struct HeapBlock;
+
+struct HeapStats {
+	unsigned long long s_Capacity;
+	unsigned long long s_UsedBytes;
+	unsigned long long s_FreeBytes;
+	unsigned long long s_LargestFreeBlock;
+	unsigned int s_FreeBlockCount;
+	unsigned int s_UsedBlockCount;
+	// 0 means all free memory is one contiguous block, approaching 1 means it is scattered
+	float s_Fragmentation;
+};
+
+class HeapAllocator {
+public:
+	HeapAllocator() = default;
+	HeapAllocator(const HeapAllocator&) = delete;
+	HeapAllocator& operator=(const HeapAllocator&) = delete;
+
+	// The heap does not own the memory it manages. The region has to outlive the heap.
+	bool Create(void* memory, unsigned long long size);
+	void Destroy();
+	// Adds size bytes that directly follow the current region, used to grow a heap
+	// whose region was reserved larger than it was committed
+	bool Extend(unsigned long long size);
+
+	// Returns nullptr if no free block is large enough
+	void* Allocate(unsigned long long size);
+	void Free(void* block);
+
+	// Usable size of a block returned by Allocate
+	static unsigned long long GetBlockSize(const void* block);
+
+	bool Owns(const void* block) const { return block >= m_Memory && block < m_Memory + m_Capacity; }
+	bool IsCreated() const { return m_Memory != nullptr; }
+
+	HeapStats GetStats();
+private:
+	void insertFreeBlock(HeapBlock* block);
+	void removeFreeBlock(HeapBlock* block);
+	HeapBlock* findFreeBlock(unsigned long long size);
+
+	void lock();
+	void unlock();
+private:
+	char* m_Memory = nullptr;
+	unsigned long long m_Capacity = 0;
+
+	unsigned int m_FlBitmap = 0;
+	unsigned int m_SlBitmap[HEAP_FL_INDEX_COUNT] = {};
+	HeapBlock* m_FreeLists[HEAP_FL_INDEX_COUNT][HEAP_SL_INDEX_COUNT] = {};
+
+	unsigned long long m_UsedBytes = 0;
+	unsigned long long m_FreeBytes = 0;
+	unsigned int m_FreeBlockCount = 0;
+	unsigned int m_UsedBlockCount = 0;
+
+	std::atomic_flag m_Lock = ATOMIC_FLAG_INIT;
+};
@@ -1,71 +1,241 @@
+#include <emmintrin.h>
+
 #include "Input.hpp"
-#include "Memory.hpp"
 #include "Event.hpp"
 
 int Input::m_MouseScrolled;
-Array<bool, MOUSE_CODE_MAX> Input::m_IsMousePressed;
-Array<bool, MOUSE_CODE_MAX> Input::m_WasMousePressed;
-
-Array<bool, KEY_CODE_MAX> Input::m_IsKeyPressed;
-Array<bool, KEY_CODE_MAX> Input::m_WasKeyPressed;
+int Input::m_MouseX;
+int Input::m_MouseY;
+InputBitset Input::m_Keys;
+InputBitset Input::m_Mouse;
+InputFrame Input::m_History[INPUT_HISTORY_FRAMES];
+unsigned int Input::m_Frame;
+InputSample Input::m_Samples[INPUT_SAMPLE_CAPACITY];
+alignas(64) std::atomic<unsigned long long> Input::m_SampleHead;
+alignas(64) std::atomic<unsigned long long> Input::m_SampleTail;
+std::atomic<unsigned long long> Input::m_DroppedSamples;
+InputSample Input::m_FrameSamples[INPUT_SAMPLE_CAPACITY];
+unsigned int Input::m_FrameSampleCount;
+bool Input::m_Replaying;
 
 bool Input::IsKeyPressed(KeyCode code) {
-	return m_IsKeyPressed[code];
+	return (unsigned int)code < INPUT_BITSET_BITS && m_Keys.Test(code);
 }
 
 bool Input::WasKeyPressed(KeyCode code) {
-	return m_WasKeyPressed[code];
+	return (unsigned int)code < INPUT_BITSET_BITS && getFrame(1).s_Keys.Test(code);
 }
 
-bool Input::ProcessKeyInput(KeyCode code, bool pressed) {
-	if (m_IsKeyPressed[code] != pressed) {
-		m_IsKeyPressed[code] = pressed;
+bool Input::IsKeyJustPressed(KeyCode code) {
+	return (unsigned int)code < INPUT_BITSET_BITS && getFrame(0).s_KeysPressed.Test(code);
+}
 
-		EventContext c{};
-		c.u32[0] = code;
-		if (pressed) {
-			EventSystem::FireEvent(0, c, EVENT_TYPE_KEY_PRESSED);
-		}
-		else {
-			EventSystem::FireEvent(0, c, EVENT_TYPE_KEY_RELEASED);
-		}
-		return true;
-	}
-	return false;
+bool Input::IsKeyJustReleased(KeyCode code) {
+	return (unsigned int)code < INPUT_BITSET_BITS && getFrame(0).s_KeysReleased.Test(code);
+}
+
+bool Input::WasKeyPressedWithin(KeyCode code, unsigned int frames) {
+	return (unsigned int)code < INPUT_BITSET_BITS && wasPressedWithin(&InputFrame::s_KeysPressed, code, frames);
 }
 
 bool Input::IsMouseButtonPressed(MouseCode code) {
-	return m_IsMousePressed[code];
+	return (unsigned int)code < MOUSE_CODE_MAX && m_Mouse.Test(code);
 }
 
 bool Input::WasMouseButtonPressed(MouseCode code) {
-	return m_WasMousePressed[code];
+	return (unsigned int)code < MOUSE_CODE_MAX && getFrame(1).s_Mouse.Test(code);
+}
+
+bool Input::IsMouseButtonJustPressed(MouseCode code) {
+	return (unsigned int)code < MOUSE_CODE_MAX && getFrame(0).s_MousePressed.Test(code);
+}
+
+bool Input::IsMouseButtonJustReleased(MouseCode code) {
+	return (unsigned int)code < MOUSE_CODE_MAX && getFrame(0).s_MouseReleased.Test(code);
+}
+
+bool Input::WasMouseButtonPressedWithin(MouseCode code, unsigned int frames) {
+	return (unsigned int)code < MOUSE_CODE_MAX && wasPressedWithin(&InputFrame::s_MousePressed, code, frames);
+}
+
+int Input::MousedScrolled() {
+	return m_MouseScrolled;
+}
+
+bool Input::PushSample(const InputSample& sample) {
+	unsigned long long head = m_SampleHead.load(std::memory_order_relaxed);
+	if (head - m_SampleTail.load(std::memory_order_acquire) == INPUT_SAMPLE_CAPACITY) {
+		m_DroppedSamples.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	m_Samples[head & (INPUT_SAMPLE_CAPACITY - 1)] = sample;
+	m_SampleHead.store(head + 1, std::memory_order_release);
+	return true;
+}
+
+bool Input::ProcessKeyInput(KeyCode code, bool pressed, double time) {
+	if ((unsigned int)code >= INPUT_BITSET_BITS) {
+		return false;
+	}
+	return PushSample({ time, INPUT_SAMPLE_KEY, (unsigned int)code, pressed, 0, 0, 0 });
 }
 
-bool Input::ProcessMouseInput(MouseCode code, bool pressed) {
-	if (m_IsMousePressed[code] != pressed) {
-		m_IsMousePressed[code] = pressed;
+bool Input::ProcessMouseInput(MouseCode code, bool pressed, double time) {
+	if ((unsigned int)code >= MOUSE_CODE_MAX) {
+		return false;
+	}
+	return PushSample({ time, INPUT_SAMPLE_MOUSE_BUTTON, (unsigned int)code, pressed, 0, 0, 0 });
+}
+
+bool Input::ProcessMouseMove(int x, int y, double time) {
+	return PushSample({ time, INPUT_SAMPLE_MOUSE_MOVE, 0, false, x, y, 0 });
+}
+
+bool Input::ProcessMouseWheel(int delta, int x, int y, double time) {
+	return PushSample({ time, INPUT_SAMPLE_MOUSE_WHEEL, 0, false, x, y, delta });
+}
 
-		EventContext c{};
-		c.u32[0] = code;
-		if (pressed) {
-			EventSystem::FireEvent(nullptr, c, EVENT_TYPE_MOUSE_CLICKED);
+bool Input::wasPressedWithin(const InputBitset InputFrame::* edges, unsigned int bit, unsigned int frames) {
+	if (frames > INPUT_HISTORY_FRAMES) {
+		frames = INPUT_HISTORY_FRAMES;
+	}
+	unsigned long long word = 0;
+	for (unsigned int age = 0; age < frames; age++) {
+		word |= (getFrame(age).*edges).s_Words[bit >> 6];
+	}
+	return (word >> (bit & 63)) & 1;
+}
+
+void Input::applySample(const InputSample& sample, InputFrame& edges) {
+	EventContext c{};
+	switch (sample.s_Type) {
+		case INPUT_SAMPLE_KEY: {
+			if (m_Keys.Test(sample.s_Code) == sample.s_Pressed) {
+				break;
+			}
+			m_Keys.Set(sample.s_Code, sample.s_Pressed);
+			(sample.s_Pressed ? edges.s_KeysPressed : edges.s_KeysReleased).Set(sample.s_Code, true);
+			c.u32[0] = sample.s_Code;
+			EventSystem::PostEvent(nullptr, c, sample.s_Pressed ? EVENT_TYPE_KEY_PRESSED : EVENT_TYPE_KEY_RELEASED);
+			break;
+		}
+		case INPUT_SAMPLE_MOUSE_BUTTON: {
+			if (m_Mouse.Test(sample.s_Code) == sample.s_Pressed) {
+				break;
+			}
+			m_Mouse.Set(sample.s_Code, sample.s_Pressed);
+			(sample.s_Pressed ? edges.s_MousePressed : edges.s_MouseReleased).Set(sample.s_Code, true);
+			c.u32[0] = sample.s_Code;
+			EventSystem::PostEvent(nullptr, c, sample.s_Pressed ? EVENT_TYPE_MOUSE_CLICKED : EVENT_TYPE_MOUSE_RELEASED);
+			break;
+		}
+		case INPUT_SAMPLE_MOUSE_MOVE: {
+			m_MouseX = sample.s_X;
+			m_MouseY = sample.s_Y;
+			c.u32[0] = sample.s_X;
+			c.u32[1] = sample.s_Y;
+			EventSystem::PostEvent(nullptr, c, EVENT_TYPE_MOUSE_MOVED);
+			break;
 		}
-		else {
-			EventSystem::FireEvent(nullptr, c, EVENT_TYPE_MOUSE_RELEASED);
+		case INPUT_SAMPLE_MOUSE_WHEEL: {
+			m_MouseScrolled += sample.s_Delta;
+			c.u32[0] = sample.s_Delta;
+			c.u32[1] = sample.s_X;
+			c.u32[2] = sample.s_Y;
+			EventSystem::PostEvent(nullptr, c, EVENT_TYPE_MOUSE_SCROLLED);
+			break;
 		}
-		return true;
 	}
-	return false;
 }
 
-int Input::MousedScrolled() {
-	return m_MouseScrolled;
+// Snapshot current into frame and derive the edges against the previous frame,
+// pressed = (current & ~previous) | downs, released = (previous & ~current) | ups.
+// Downs and ups are the transitions seen in the samples, so a tap that went down and up
+// again between two Updates still shows up as pressed and released.
+static void snapshotBitset(const InputBitset& current, const InputBitset& previous, InputBitset& state, InputBitset& pressed, InputBitset& released) {
+	for (unsigned int i = 0; i < INPUT_BITSET_BITS / 128; i++) {
+		__m128i now = _mm_load_si128((const __m128i*)current.s_Words + i);
+		__m128i before = _mm_load_si128((const __m128i*)previous.s_Words + i);
+		__m128i downs = _mm_load_si128((const __m128i*)pressed.s_Words + i);
+		__m128i ups = _mm_load_si128((const __m128i*)released.s_Words + i);
+		_mm_store_si128((__m128i*)state.s_Words + i, now);
+		_mm_store_si128((__m128i*)pressed.s_Words + i, _mm_or_si128(_mm_andnot_si128(before, now), downs));
+		_mm_store_si128((__m128i*)released.s_Words + i, _mm_or_si128(_mm_andnot_si128(now, before), ups));
+	}
+}
+
+// Turns a recorded input event back into the sample that posted it. Moves and wheel
+// deltas were coalesced per frame, so they come back as one sample each.
+static bool sampleFromRecord(const EventRecord& record, InputSample& sample) {
+	sample = {};
+	sample.s_Time = record.s_TimeNs / 1000000000.0;
+	switch (record.s_Type) {
+		case EVENT_TYPE_KEY_PRESSED:
+		case EVENT_TYPE_KEY_RELEASED:
+			sample.s_Type = INPUT_SAMPLE_KEY;
+			sample.s_Code = record.s_Context.u32[0];
+			sample.s_Pressed = record.s_Type == EVENT_TYPE_KEY_PRESSED;
+			return sample.s_Code < INPUT_BITSET_BITS;
+		case EVENT_TYPE_MOUSE_CLICKED:
+		case EVENT_TYPE_MOUSE_RELEASED:
+			sample.s_Type = INPUT_SAMPLE_MOUSE_BUTTON;
+			sample.s_Code = record.s_Context.u32[0];
+			sample.s_Pressed = record.s_Type == EVENT_TYPE_MOUSE_CLICKED;
+			return sample.s_Code < MOUSE_CODE_MAX;
+		case EVENT_TYPE_MOUSE_MOVED:
+			sample.s_Type = INPUT_SAMPLE_MOUSE_MOVE;
+			sample.s_X = (int)record.s_Context.u32[0];
+			sample.s_Y = (int)record.s_Context.u32[1];
+			return true;
+		case EVENT_TYPE_MOUSE_SCROLLED:
+			sample.s_Type = INPUT_SAMPLE_MOUSE_WHEEL;
+			sample.s_Delta = (int)record.s_Context.u32[0];
+			sample.s_X = (int)record.s_Context.u32[1];
+			sample.s_Y = (int)record.s_Context.u32[2];
+			return true;
+		default:
+			return false;
+	}
 }
 
 void Input::Update() {
-	// Copy over the current key and mouse states to the last key and mouse states
-	// Should be called at the end of the main loop
-	Memory::Copy(&m_IsKeyPressed[0], &m_WasKeyPressed[0], sizeof(m_IsKeyPressed));
-	Memory::Copy(&m_IsMousePressed[0], &m_WasMousePressed[0], sizeof(m_IsMousePressed));
+	const InputFrame& previous = getFrame(0);
+	m_Frame++;
+	InputFrame& frame = m_History[m_Frame & (INPUT_HISTORY_FRAMES - 1)];
+	frame = {};
+	m_MouseScrolled = 0;
+
+	unsigned long long tail = m_SampleTail.load(std::memory_order_relaxed);
+	unsigned long long head = m_SampleHead.load(std::memory_order_acquire);
+	m_FrameSampleCount = 0;
+	if (EventSystem::IsReplaying()) {
+		if (!m_Replaying) {
+			// Replayed input starts from nothing held, live keys would never see their release
+			m_Keys = {};
+			m_Mouse = {};
+			m_Replaying = true;
+		}
+		unsigned int count;
+		const EventRecord* records = EventSystem::GetReplayFrame(count);
+		for (unsigned int i = 0; i < count && m_FrameSampleCount < INPUT_SAMPLE_CAPACITY; i++) {
+			if (sampleFromRecord(records[i], m_FrameSamples[m_FrameSampleCount])) {
+				applySample(m_FrameSamples[m_FrameSampleCount], frame);
+				m_FrameSampleCount++;
+			}
+		}
+		// Live samples are consumed but not applied
+		tail = head;
+	} else {
+		m_Replaying = false;
+	}
+	while (tail < head) {
+		m_FrameSamples[m_FrameSampleCount] = m_Samples[tail & (INPUT_SAMPLE_CAPACITY - 1)];
+		applySample(m_FrameSamples[m_FrameSampleCount], frame);
+		m_FrameSampleCount++;
+		tail++;
+	}
+	m_SampleTail.store(tail, std::memory_order_release);
+
+	snapshotBitset(m_Keys, previous.s_Keys, frame.s_Keys, frame.s_KeysPressed, frame.s_KeysReleased);
+	snapshotBitset(m_Mouse, previous.s_Mouse, frame.s_Mouse, frame.s_MousePressed, frame.s_MouseReleased);
 }
\ No newline at end of file
@@ -1,5 +1,12 @@
 #pragma once
-#include "containers/Array.hpp"
+#include <atomic>
+
+// Bits in one input bitset, enough for every virtual key code
+#define INPUT_BITSET_BITS 256
+// Frames of input kept for the Within queries, has to be a power of two
+#define INPUT_HISTORY_FRAMES 32
+// Samples that can arrive between two Updates, has to be a power of two
+#define INPUT_SAMPLE_CAPACITY 1024
 
 enum MouseCode {
 	/** @brief The left mouse button */
@@ -261,24 +268,111 @@ enum KeyCode {
 	KEY_CODE_MAX
 };
 
+// 256 bits of button state, sized and aligned for two SSE registers
+struct alignas(32) InputBitset {
+	unsigned long long s_Words[INPUT_BITSET_BITS / 64];
+
+	bool Test(unsigned int bit) const { return (s_Words[bit >> 6] >> (bit & 63)) & 1; }
+	void Set(unsigned int bit, bool value) {
+		unsigned long long mask = 1ULL << (bit & 63);
+		s_Words[bit >> 6] = value ? s_Words[bit >> 6] | mask : s_Words[bit >> 6] & ~mask;
+	}
+};
+
+enum InputSampleType {
+	INPUT_SAMPLE_KEY,
+	INPUT_SAMPLE_MOUSE_BUTTON,
+	INPUT_SAMPLE_MOUSE_MOVE,
+	INPUT_SAMPLE_MOUSE_WHEEL,
+};
+
+// One raw input message, stamped when it arrived
+struct InputSample {
+	// Platform::getAbsoluteTime seconds
+	double s_Time;
+	InputSampleType s_Type;
+	// KeyCode or MouseCode
+	unsigned int s_Code;
+	bool s_Pressed;
+	// Cursor position, screen space for the wheel
+	int s_X;
+	int s_Y;
+	// Wheel delta, 120 per notch
+	int s_Delta;
+};
+
+// State of one frame, taken by Input::Update
+struct InputFrame {
+	InputBitset s_Keys;
+	InputBitset s_KeysPressed;
+	InputBitset s_KeysReleased;
+	InputBitset s_Mouse;
+	InputBitset s_MousePressed;
+	InputBitset s_MouseReleased;
+};
+
+// Input arrives as samples in a single producer ring, filled by the thread that receives
+// the window messages or by a dedicated input thread. Update applies them on the main thread,
+// so everything below except the Process and PushSample calls belongs to the main thread.
 class Input {
 public:
+	// State after the last Update
 	static bool IsKeyPressed(KeyCode code);
+	// State at the Update before
 	static bool WasKeyPressed(KeyCode code);
-	static bool ProcessKeyInput(KeyCode code, bool pressed);
+	// Went down or up between the last two Updates, taps shorter than a frame included
+	static bool IsKeyJustPressed(KeyCode code);
+	static bool IsKeyJustReleased(KeyCode code);
+	// Went down in any of the last frames Updates, at most INPUT_HISTORY_FRAMES
+	static bool WasKeyPressedWithin(KeyCode code, unsigned int frames);
 
 	static bool IsMouseButtonPressed(MouseCode);
 	static bool WasMouseButtonPressed(MouseCode);
-	static bool ProcessMouseInput(MouseCode code, bool pressed);
+	static bool IsMouseButtonJustPressed(MouseCode code);
+	static bool IsMouseButtonJustReleased(MouseCode code);
+	static bool WasMouseButtonPressedWithin(MouseCode code, unsigned int frames);
 
+	// Wheel delta summed over the samples of this frame
 	static int MousedScrolled();
+	static int GetMouseX() { return m_MouseX; }
+	static int GetMouseY() { return m_MouseY; }
+
+	// Producer side, returns false if the ring is full and the sample was dropped
+	static bool PushSample(const InputSample& sample);
+	static bool ProcessKeyInput(KeyCode code, bool pressed, double time);
+	static bool ProcessMouseInput(MouseCode code, bool pressed, double time);
+	static bool ProcessMouseMove(int x, int y, double time);
+	static bool ProcessMouseWheel(int delta, int x, int y, double time);
 
+	// Every sample applied by the last Update in arrival order, for sub-frame input
+	static const InputSample* GetFrameSamples() { return m_FrameSamples; }
+	static unsigned int GetFrameSampleCount() { return m_FrameSampleCount; }
+	static unsigned long long GetDroppedSamples() { return m_DroppedSamples.load(std::memory_order_relaxed); }
+
+	// Applies the samples that arrived since the last call, posts their events and takes
+	// the snapshot of this frame. Call once per frame before the events are dispatched.
+	// While the EventSystem replays, live samples are dropped and the recorded input of
+	// the frame is applied instead, starting from released keys and buttons.
 	static void Update();
 private:
+	static const InputFrame& getFrame(unsigned int age) { return m_History[(m_Frame - age) & (INPUT_HISTORY_FRAMES - 1)]; }
+	static bool wasPressedWithin(const InputBitset InputFrame::* edges, unsigned int bit, unsigned int frames);
+	static void applySample(const InputSample& sample, InputFrame& edges);
+
 	static int m_MouseScrolled;
-	static Array<bool, MOUSE_CODE_MAX> m_IsMousePressed;
-	static Array<bool, MOUSE_CODE_MAX> m_WasMousePressed;
+	static int m_MouseX;
+	static int m_MouseY;
+	static InputBitset m_Keys;
+	static InputBitset m_Mouse;
+
+	static InputFrame m_History[INPUT_HISTORY_FRAMES];
+	static unsigned int m_Frame;
 
-	static Array<bool, KEY_CODE_MAX> m_IsKeyPressed;
-	static Array<bool, KEY_CODE_MAX> m_WasKeyPressed;
+	static InputSample m_Samples[INPUT_SAMPLE_CAPACITY];
+	alignas(64) static std::atomic<unsigned long long> m_SampleHead;
+	alignas(64) static std::atomic<unsigned long long> m_SampleTail;
+	static std::atomic<unsigned long long> m_DroppedSamples;
+	static InputSample m_FrameSamples[INPUT_SAMPLE_CAPACITY];
+	static unsigned int m_FrameSampleCount;
+	static bool m_Replaying;
 };
\ No newline at end of file
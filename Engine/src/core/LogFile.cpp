@@ -0,0 +1,260 @@
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include <stdio.h>
+#include <string.h>
+
+#include "LogFile.hpp"
+
+#define LOG_FILE_SEGMENT_HEADER "# Log segment %llu\n"
+#define LOG_FILE_RECOVERED_MARKER "# Recovered after a crash, the line that was being written is lost\n"
+
+LogFileConfig LogFile::m_Config;
+char LogFile::m_Path[LOG_FILE_MAX_PATH];
+bool LogFile::m_Open;
+LogSegment LogFile::m_Segment;
+unsigned long long LogFile::m_Sequence;
+std::chrono::steady_clock::time_point LogFile::m_SegmentStart;
+std::mutex LogFile::m_Mutex;
+
+// Errors reported from inside Write come back to Write through the logger
+static thread_local bool s_InWrite;
+
+// Platform part, maps a file at size bytes (0 keeps its current size) and unmaps it at a final size
+
+#ifdef _WIN32
+
+static bool mapSegment(const char* path, unsigned long long size, bool create, LogSegment& segment) {
+	HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, create ? CREATE_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	if (size == 0) {
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+			CloseHandle(file);
+			return false;
+		}
+		size = fileSize.QuadPart;
+	}
+	// A mapping larger than the file grows the file, the new part reads as zeros
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, (DWORD)(size >> 32), (DWORD)size, nullptr);
+	void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, (SIZE_T)size) : nullptr;
+	if (!view) {
+		if (mapping) {
+			CloseHandle(mapping);
+		}
+		CloseHandle(file);
+		return false;
+	}
+	segment.s_Base = (char*)view;
+	segment.s_Size = size;
+	segment.s_Written = 0;
+	segment.s_File = file;
+	segment.s_Mapping = mapping;
+	return true;
+}
+
+static void unmapSegment(LogSegment& segment, unsigned long long finalSize) {
+	UnmapViewOfFile(segment.s_Base);
+	CloseHandle((HANDLE)segment.s_Mapping);
+	LARGE_INTEGER end;
+	end.QuadPart = (LONGLONG)finalSize;
+	SetFilePointerEx((HANDLE)segment.s_File, end, nullptr, FILE_BEGIN);
+	SetEndOfFile((HANDLE)segment.s_File);
+	CloseHandle((HANDLE)segment.s_File);
+	segment = LogSegment{};
+}
+
+static void syncSegment(LogSegment& segment) {
+	FlushViewOfFile(segment.s_Base, (SIZE_T)segment.s_Written);
+	FlushFileBuffers((HANDLE)segment.s_File);
+}
+
+#else
+
+static bool mapSegment(const char* path, unsigned long long size, bool create, LogSegment& segment) {
+	int descriptor = open(path, create ? O_RDWR | O_CREAT | O_TRUNC : O_RDWR, 0644);
+	if (descriptor < 0) {
+		return false;
+	}
+	if (size == 0) {
+		struct stat info;
+		if (fstat(descriptor, &info) != 0 || info.st_size == 0) {
+			close(descriptor);
+			return false;
+		}
+		size = (unsigned long long)info.st_size;
+	}
+	else if (ftruncate(descriptor, (off_t)size) != 0) {
+		close(descriptor);
+		return false;
+	}
+	void* view = mmap(nullptr, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+	if (view == MAP_FAILED) {
+		close(descriptor);
+		return false;
+	}
+	segment.s_Base = (char*)view;
+	segment.s_Size = size;
+	segment.s_Written = 0;
+	segment.s_File = (void*)(intptr_t)descriptor;
+	segment.s_Mapping = nullptr;
+	return true;
+}
+
+static void unmapSegment(LogSegment& segment, unsigned long long finalSize) {
+	int descriptor = (int)(intptr_t)segment.s_File;
+	munmap(segment.s_Base, (size_t)segment.s_Size);
+	if (ftruncate(descriptor, (off_t)finalSize) != 0) {
+		// The file keeps its zero tail, the next Open trims it
+	}
+	close(descriptor);
+	segment = LogSegment{};
+}
+
+static void syncSegment(LogSegment& segment) {
+	msync(segment.s_Base, (size_t)segment.s_Written, MS_SYNC);
+}
+
+#endif
+
+bool LogFile::Open(const LogFileConfig& config) {
+	if (m_Open) {
+		EN_WARN("LogFile::Open was called while a log file is open.");
+		return false;
+	}
+	if (!config.s_Path || strlen(config.s_Path) + 16 > LOG_FILE_MAX_PATH || config.s_MaxSegments == 0) {
+		EN_ERROR("LogFile::Open was called with an invalid path or no segments.");
+		return false;
+	}
+	m_Config = config;
+	if (m_Config.s_SegmentSize < LOG_FILE_MIN_SEGMENT_SIZE) {
+		m_Config.s_SegmentSize = LOG_FILE_MIN_SEGMENT_SIZE;
+	}
+	strcpy(m_Path, config.s_Path);
+
+	// Continue after the newest segment of the last run, trimming what a crash left behind
+	unsigned long long newest = 0;
+	char path[LOG_FILE_MAX_PATH];
+	for (unsigned int slot = 0; slot < m_Config.s_MaxSegments; slot++) {
+		getSegmentPath(path, slot);
+		unsigned long long sequence = recoverSegment(path);
+		if (sequence > newest) {
+			newest = sequence;
+		}
+	}
+
+	s_InWrite = true;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Open = openSegment(newest + 1);
+	}
+	s_InWrite = false;
+	return m_Open;
+}
+
+void LogFile::Close() {
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	if (!m_Open) {
+		return;
+	}
+	unmapSegment(m_Segment, m_Segment.s_Written);
+	m_Open = false;
+}
+
+void LogFile::Write(LogLevel level, const char* text, unsigned int length) {
+	if (s_InWrite) {
+		return;
+	}
+	s_InWrite = true;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (m_Open) {
+			bool full = m_Segment.s_Written + length > m_Segment.s_Size;
+			bool old = m_Config.s_RotateSeconds > 0 &&
+				std::chrono::steady_clock::now() - m_SegmentStart >= std::chrono::seconds(m_Config.s_RotateSeconds);
+			if (full || old) {
+				unmapSegment(m_Segment, m_Segment.s_Written);
+				m_Open = openSegment(m_Sequence + 1);
+			}
+			if (m_Open) {
+				// Only a batch larger than a whole segment gets cut
+				unsigned long long size = length;
+				if (m_Segment.s_Written + size > m_Segment.s_Size) {
+					size = m_Segment.s_Size - m_Segment.s_Written;
+				}
+				memcpy(m_Segment.s_Base + m_Segment.s_Written, text, (size_t)size);
+				m_Segment.s_Written += size;
+				if (level >= m_Config.s_SyncLevel) {
+					syncSegment(m_Segment);
+				}
+			}
+		}
+	}
+	s_InWrite = false;
+}
+
+bool LogFile::openSegment(unsigned long long sequence) {
+	char path[LOG_FILE_MAX_PATH];
+	getSegmentPath(path, (unsigned int)(sequence % m_Config.s_MaxSegments));
+	if (!mapSegment(path, m_Config.s_SegmentSize, true, m_Segment)) {
+		EN_ERROR("Cannot create log segment '%s', file logging stops.", path);
+		return false;
+	}
+	m_Segment.s_Written = (unsigned long long)snprintf(m_Segment.s_Base, (size_t)m_Segment.s_Size, LOG_FILE_SEGMENT_HEADER, sequence);
+	m_Sequence = sequence;
+	m_SegmentStart = std::chrono::steady_clock::now();
+	return true;
+}
+
+unsigned long long LogFile::recoverSegment(const char* path) {
+	LogSegment segment;
+	if (!mapSegment(path, 0, false, segment)) {
+		return 0;
+	}
+
+	char header[64] = {};
+	memcpy(header, segment.s_Base, segment.s_Size < sizeof(header) - 1 ? (size_t)segment.s_Size : sizeof(header) - 1);
+	unsigned long long sequence = 0;
+	if (sscanf(header, LOG_FILE_SEGMENT_HEADER, &sequence) != 1) {
+		sequence = 0;
+	}
+
+	unsigned long long size = segment.s_Size;
+	if (segment.s_Base[size - 1] == '\0') {
+		// Log text has no zero bytes, so the written part is everything before the first one
+		unsigned long long low = 0;
+		unsigned long long high = size;
+		while (low < high) {
+			unsigned long long middle = low + (high - low) / 2;
+			if (segment.s_Base[middle] == '\0') {
+				high = middle;
+			}
+			else {
+				low = middle + 1;
+			}
+		}
+		unsigned long long end = low;
+		while (end > 0 && segment.s_Base[end - 1] != '\n') {
+			end--;
+		}
+		size = end;
+		if (size + sizeof(LOG_FILE_RECOVERED_MARKER) - 1 <= segment.s_Size) {
+			memcpy(segment.s_Base + size, LOG_FILE_RECOVERED_MARKER, sizeof(LOG_FILE_RECOVERED_MARKER) - 1);
+			size += sizeof(LOG_FILE_RECOVERED_MARKER) - 1;
+		}
+		EN_WARN("Log segment '%s' was not closed, trimmed it to %llu bytes.", path, size);
+	}
+	unmapSegment(segment, size);
+	return sequence;
+}
+
+void LogFile::getSegmentPath(char* buffer, unsigned int slot) {
+	snprintf(buffer, LOG_FILE_MAX_PATH, "%s.%u.log", m_Path, slot);
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <chrono>
+#include <mutex>
+
+#include "Logger.hpp"
+
+// Smallest segment Open accepts, it has to hold the largest batch the logger hands to a sink
+#define LOG_FILE_MIN_SEGMENT_SIZE (1024ULL * 1024)
+#define LOG_FILE_MAX_PATH 260
+
+struct LogFileConfig {
+	// Segments are written to <s_Path>.<slot>.log
+	const char* s_Path = nullptr;
+	// Every segment is created at this size and mapped whole
+	unsigned long long s_SegmentSize = 64ULL * 1024 * 1024;
+	// Slots are reused in turn, so at most this many segments exist
+	unsigned int s_MaxSegments = 8;
+	// A segment older than this is rotated even if it has room left, 0 rotates on size only
+	unsigned int s_RotateSeconds = 3600;
+	// Writes from this level on are on disk before Write returns
+	LogLevel s_SyncLevel = LOG_LEVEL_ERROR;
+};
+
+// One mapped segment file
+struct LogSegment {
+	char* s_Base = nullptr;
+	unsigned long long s_Size = 0;
+	unsigned long long s_Written = 0;
+	// HANDLE on Windows, file descriptor elsewhere
+	void* s_File = nullptr;
+	void* s_Mapping = nullptr;
+};
+
+// Logger sink that copies text into a memory mapped, pre-sized segment file, so a write is a
+// memcpy and the operating system writes the pages back on its own. A segment left behind by
+// a crash still has its zero filled tail, Open cuts it back to the last complete line.
+class LogFile {
+public:
+	static bool Open(const LogFileConfig& config);
+	// Cuts the current segment to what was written
+	static void Close();
+	// Has the pfnLogSink signature, pass it to Logger::AddSink
+	static void Write(LogLevel level, const char* text, unsigned int length);
+	static bool IsOpen() { return m_Open; }
+private:
+	static bool openSegment(unsigned long long sequence);
+	// Trims a segment a crash left at full size, returns its sequence number or 0
+	static unsigned long long recoverSegment(const char* path);
+	static void getSegmentPath(char* buffer, unsigned int slot);
+
+	static LogFileConfig m_Config;
+	static char m_Path[LOG_FILE_MAX_PATH];
+	static bool m_Open;
+	static LogSegment m_Segment;
+	static unsigned long long m_Sequence;
+	static std::chrono::steady_clock::time_point m_SegmentStart;
+	static std::mutex m_Mutex;
+};
@@ -1,19 +1,107 @@
 #include <stdio.h>
-#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "Logger.hpp"
 #include "Platform.hpp"
-#include "Memory.hpp"
 
+// Text the writer thread hands to the sinks in one call
+#define LOG_BATCH_SIZE 16384
+// Binary records collected before they go to the file
+#define LOG_BINARY_BUFFER_SIZE 65536
 
-#define LOG_MESSAGE_MAX_LENTH 2048
+static const char* s_LevelStrings[6] = { "[TRACE]: ", "[INFO]: ", "[DEBUG]: " , "[WARN]: " , "[ERROR]: " , "[FATAL]: " };
+static const unsigned int s_LevelStringLengths[6] = { 9, 8, 9, 8, 9, 9 };
+
+static void consoleSink(LogLevel level, const char* text, unsigned int length) {
+	Platform::logMessage(level, text);
+}
 
 unsigned int Logger::m_LogLevel;
 
-void Logger::Initialize(unsigned int logLevel) {
-	// Test output
+QueuedLogMessage Logger::m_Queue[LOG_QUEUE_CAPACITY];
+alignas(64) std::atomic<unsigned long long> Logger::m_QueueHead;
+alignas(64) std::atomic<unsigned long long> Logger::m_QueueTail;
+std::atomic<unsigned long long> Logger::m_Dropped;
+
+pfnLogSink Logger::m_Sinks[LOG_MAX_SINKS] = { consoleSink };
+std::atomic<unsigned int> Logger::m_SinkCount{ 1 };
+
+std::thread Logger::m_Writer;
+std::atomic<std::thread::id> Logger::m_WriterId;
+std::atomic<bool> Logger::m_Running;
+std::atomic<bool> Logger::m_StopWriter;
+std::mutex Logger::m_WakeMutex;
+std::condition_variable Logger::m_Wake;
+bool Logger::m_WakeRequested;
+
+File Logger::m_BinaryFile;
+bool Logger::m_BinaryOpen;
+const char* Logger::m_FormatKeys[LOG_FORMAT_TABLE_SIZE];
+unsigned long long Logger::m_FormatIds[LOG_FORMAT_TABLE_SIZE];
+unsigned long long Logger::m_NextFormatId;
+
+std::atomic<unsigned int> Logger::m_RateLimits[LOG_LEVEL_FATAL + 1] = {
+	LOG_DEFAULT_RATE_LIMIT, LOG_DEFAULT_RATE_LIMIT, LOG_DEFAULT_RATE_LIMIT, LOG_DEFAULT_RATE_LIMIT, LOG_DEFAULT_RATE_LIMIT, 0
+};
+std::atomic<bool> Logger::m_SuppressDuplicates[LOG_LEVEL_FATAL + 1] = { true, true, true, true, true, false };
+std::atomic<LogSite*> Logger::m_SuppressedSites;
+
+LogLevel Logger::m_LastLevel;
+const char* Logger::m_LastFormat;
+unsigned int Logger::m_LastLength;
+bool Logger::m_LastTruncated;
+bool Logger::m_HasLast;
+char Logger::m_LastMessage[LOG_MESSAGE_MAX_LENGTH];
+unsigned long long Logger::m_Repeats;
+
+static char s_BinaryBuffer[LOG_BINARY_BUFFER_SIZE];
+static unsigned int s_BinaryLength;
+
+static char s_Batch[LOG_BATCH_SIZE];
+static unsigned int s_BatchLength;
+static LogLevel s_BatchLevel;
+
+static unsigned long long getTimeMs() {
+	return (unsigned long long)std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Logger::Initialize(unsigned int logLevel, const char* binaryLogPath) {
 	m_LogLevel = logLevel;
+	if (m_Running.load(std::memory_order_acquire)) {
+		return;
+	}
 
+	if (binaryLogPath) {
+		m_BinaryOpen = m_BinaryFile.Open(binaryLogPath, FILE_MODE_WRITE, true);
+		if (m_BinaryOpen) {
+			memset(m_FormatKeys, 0, sizeof(m_FormatKeys));
+			m_NextFormatId = 1;
+			s_BinaryLength = 0;
+			LogFileHeader header{ LOG_FILE_MAGIC, LOG_FILE_VERSION };
+			writeBinary(&header, sizeof(header));
+		}
+		else {
+			EN_ERROR("Cannot open binary log '%s', logging as text only.", binaryLogPath);
+		}
+	}
+
+	for (unsigned int i = 0; i < LOG_QUEUE_CAPACITY; i++) {
+		m_Queue[i].s_Sequence.store(i, std::memory_order_relaxed);
+	}
+	m_QueueHead.store(0, std::memory_order_relaxed);
+	m_QueueTail.store(0, std::memory_order_relaxed);
+	m_HasLast = false;
+	m_Repeats = 0;
+	m_WakeRequested = false;
+	// The writer has to be known before anyone queues, or its own messages would be queued to itself
+	m_StopWriter.store(false, std::memory_order_relaxed);
+	m_Writer = std::thread(writerMain);
+	m_WriterId.store(m_Writer.get_id(), std::memory_order_relaxed);
+	m_Running.store(true, std::memory_order_release);
+
+	// Test output
 	EN_TRACE("Test message %f", 3.141);
 	EN_INFO("Test message %f", 3.141);
 	EN_DEBUG("Test message %f", 3.141);
@@ -21,28 +109,667 @@ void Logger::Initialize(unsigned int logLevel) {
 	EN_ERROR("Test message %f", 3.141);
 	EN_FATAL("Test message %f", 3.141);
 }
+
+void Logger::Shutdown() {
+	if (!m_Running.load(std::memory_order_acquire)) {
+		return;
+	}
+	m_Running.store(false, std::memory_order_release);
+	m_StopWriter.store(true, std::memory_order_release);
+	wakeWriter();
+	m_Writer.join();
+	m_WriterId.store(std::thread::id(), std::memory_order_relaxed);
+	// Producers that saw the writer running just before it stopped
+	drain();
+	reportRepeats();
+	flushBatch();
+
+	if (m_BinaryOpen) {
+		flushBinary();
+		m_BinaryFile.Close();
+		m_BinaryOpen = false;
+	}
+}
+
 void Logger::LogMessage(LogLevel level, const char* message, ...) {
+	if (m_LogLevel > (unsigned int)level || (unsigned int)level > LOG_LEVEL_FATAL) {
+		return;
+	}
+
+	va_list args;
+	va_start(args, message);
+	unsigned long long position;
+	bool queued;
+	QueuedLogMessage* slot = claimSlot(level, position, queued);
+	if (!queued) {
+		writeDirect(level, message, args);
+	}
+	else if (slot) {
+		int length = vsnprintf(slot->s_Message, LOG_MESSAGE_MAX_LENGTH, message, args);
+		if (length < 0) {
+			length = 0;
+		}
+		else if (length >= LOG_MESSAGE_MAX_LENGTH) {
+			length = LOG_MESSAGE_MAX_LENGTH - 1;
+		}
+		slot->s_Format = nullptr;
+		slot->s_Level = level;
+		slot->s_Length = (unsigned int)length;
+		slot->s_Truncated = false;
+		publish(slot, position);
+	}
+	va_end(args);
 
-	if (m_LogLevel <= (unsigned int) level) {
-		char buffer[LOG_MESSAGE_MAX_LENTH];
-		 
-		const char* levelStrings[6] = { "[TRACE]: ", "[INFO]: ", "[DEBUG]: " , "[WARN]: " , "[ERROR]: " , "[FATAL]: " };
+	if (level == LOG_LEVEL_FATAL) {
+		Flush();
+	}
+}
 
-		Memory::ZeroOut(buffer, sizeof(char) * LOG_MESSAGE_MAX_LENTH);
+void Logger::Flush() {
+	if (!m_Running.load(std::memory_order_acquire) || std::this_thread::get_id() == m_WriterId.load(std::memory_order_relaxed)) {
+		return;
+	}
+	unsigned long long target = m_QueueHead.load(std::memory_order_relaxed);
+	std::unique_lock<std::mutex> lock(m_WakeMutex);
+	m_WakeRequested = true;
+	m_Wake.notify_all();
+	m_Wake.wait_for(lock, std::chrono::milliseconds(LOG_FLUSH_TIMEOUT_MS), [target]() {
+		return m_QueueTail.load(std::memory_order_acquire) >= target;
+	});
+}
 
-		va_list arg_ptr;
-		va_start(arg_ptr, message);
-		vsprintf_s(buffer, message, arg_ptr);
-		va_end(arg_ptr);
+bool Logger::AddSink(pfnLogSink sink) {
+	unsigned int count = m_SinkCount.load(std::memory_order_relaxed);
+	if (!sink || count == LOG_MAX_SINKS) {
+		return false;
+	}
+	m_Sinks[count] = sink;
+	m_SinkCount.store(count + 1, std::memory_order_release);
+	return true;
+}
 
-		char out_message[LOG_MESSAGE_MAX_LENTH];
-		// Append the message severity to the buffer
-		if (level < 6) {
-			sprintf_s(out_message, "%s%s\n", levelStrings[level], buffer);
+QueuedLogMessage* Logger::claimSlot(LogLevel level, unsigned long long& position, bool& queued) {
+	// Sinks that log end up here on the writer thread, which cannot wait for itself
+	queued = m_Running.load(std::memory_order_acquire) && std::this_thread::get_id() != m_WriterId.load(std::memory_order_relaxed);
+	if (!queued) {
+		return nullptr;
+	}
+
+	QueuedLogMessage* slot;
+	position = m_QueueHead.load(std::memory_order_relaxed);
+	for (;;) {
+		slot = &m_Queue[position & (LOG_QUEUE_CAPACITY - 1)];
+		unsigned long long sequence = slot->s_Sequence.load(std::memory_order_acquire);
+		long long difference = (long long)(sequence - position);
+		if (difference == 0) {
+			if (m_QueueHead.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+				return slot;
+			}
+		}
+		else if (difference < 0) {
+			// The queue is full, errors wait for the writer and everything else is dropped
+			if (level < LOG_LEVEL_ERROR) {
+				m_Dropped.fetch_add(1, std::memory_order_relaxed);
+				return nullptr;
+			}
+			wakeWriter();
+			std::this_thread::yield();
+			position = m_QueueHead.load(std::memory_order_relaxed);
 		}
 		else {
-			level = LOG_LEVEL_TRACE;
+			// Another producer claimed this position first
+			position = m_QueueHead.load(std::memory_order_relaxed);
 		}
-		Platform::logMessage(level, out_message);
 	}
-}
\ No newline at end of file
+}
+
+void Logger::publish(QueuedLogMessage* slot, unsigned long long position) {
+	slot->s_Sequence.store(position + 1, std::memory_order_release);
+}
+
+bool Logger::checkRate(LogSite& site, LogLevel level, const char* format) {
+	unsigned int limit = m_RateLimits[level].load(std::memory_order_relaxed);
+	if (limit == 0) {
+		return true;
+	}
+	unsigned long long now = getTimeMs();
+	unsigned long long windowStart = site.s_WindowStart.load(std::memory_order_relaxed);
+	if (now - windowStart >= 1000 && site.s_WindowStart.compare_exchange_strong(windowStart, now, std::memory_order_relaxed)) {
+		site.s_Count.store(0, std::memory_order_relaxed);
+	}
+	if (site.s_Count.fetch_add(1, std::memory_order_relaxed) < limit) {
+		return true;
+	}
+
+	site.s_Suppressed.fetch_add(1, std::memory_order_relaxed);
+	if (!site.s_Listed.exchange(true, std::memory_order_acq_rel)) {
+		// First time over the limit, the writer reports the site from now on
+		site.s_Format = format;
+		LogSite* head = m_SuppressedSites.load(std::memory_order_relaxed);
+		do {
+			site.s_Next = head;
+		} while (!m_SuppressedSites.compare_exchange_weak(head, &site, std::memory_order_release, std::memory_order_relaxed));
+	}
+	return false;
+}
+
+void Logger::writeDirect(LogLevel level, const char* message, va_list args) {
+	char buffer[LOG_MESSAGE_MAX_LENGTH + 16];
+	memcpy(buffer, s_LevelStrings[level], s_LevelStringLengths[level]);
+	unsigned int length = s_LevelStringLengths[level];
+	int written = vsnprintf(buffer + length, LOG_MESSAGE_MAX_LENGTH, message, args);
+	if (written > 0) {
+		length += written < LOG_MESSAGE_MAX_LENGTH ? written : LOG_MESSAGE_MAX_LENGTH - 1;
+	}
+	buffer[length++] = '\n';
+	buffer[length] = '\0';
+	writeToSinks(level, buffer, length);
+}
+
+void Logger::writerMain() {
+	unsigned long long reportedDrops = m_Dropped.load(std::memory_order_relaxed);
+	unsigned long long lastReport = getTimeMs();
+	while (!m_StopWriter.load(std::memory_order_acquire)) {
+		unsigned int written = drain();
+
+		unsigned long long drops = m_Dropped.load(std::memory_order_relaxed);
+		if (drops != reportedDrops) {
+			writeNotice(LOG_LEVEL_WARN, "Logger queue was full, dropped %llu messages.", drops - reportedDrops);
+			reportedDrops = drops;
+		}
+		unsigned long long now = getTimeMs();
+		if (now - lastReport >= LOG_REPORT_INTERVAL_MS) {
+			reportRepeats();
+			reportSuppressed();
+			lastReport = now;
+		}
+		flushBatch();
+		if (m_BinaryOpen) {
+			flushBinary();
+		}
+
+		std::unique_lock<std::mutex> lock(m_WakeMutex);
+		if (written > 0) {
+			// Flush waits on the same condition
+			m_Wake.notify_all();
+		}
+		m_Wake.wait_for(lock, std::chrono::milliseconds(LOG_WRITER_INTERVAL_MS), []() { return m_WakeRequested; });
+		m_WakeRequested = false;
+	}
+	drain();
+	reportRepeats();
+	reportSuppressed();
+	flushBatch();
+	std::lock_guard<std::mutex> lock(m_WakeMutex);
+	m_Wake.notify_all();
+}
+
+unsigned int Logger::drain() {
+	unsigned int written = 0;
+	bool severe = false;
+
+	unsigned long long tail = m_QueueTail.load(std::memory_order_relaxed);
+	for (;;) {
+		QueuedLogMessage& slot = m_Queue[tail & (LOG_QUEUE_CAPACITY - 1)];
+		if (slot.s_Sequence.load(std::memory_order_acquire) != tail + 1) {
+			// Empty, or the producer of the next message has not finished writing it
+			break;
+		}
+		severe |= slot.s_Level >= LOG_LEVEL_ERROR;
+
+		if (isRepeat(slot)) {
+			m_Repeats++;
+		}
+		else {
+			reportRepeats();
+			writeMessage(slot);
+		}
+
+		slot.s_Sequence.store(tail + LOG_QUEUE_CAPACITY, std::memory_order_release);
+		tail++;
+		written++;
+	}
+	flushBatch();
+	if (m_BinaryOpen && written > 0) {
+		flushBinary();
+		if (severe) {
+			m_BinaryFile.Flush();
+		}
+	}
+	// Published after the sinks ran, Flush treats everything before the tail as written
+	m_QueueTail.store(tail, std::memory_order_release);
+	return written;
+}
+
+char* Logger::reserveLine(LogLevel level) {
+	// Sinks get one call per run of messages with the same level
+	if (s_BatchLength > 0 && (level != s_BatchLevel || s_BatchLength + s_LevelStringLengths[level] + LOG_MESSAGE_MAX_LENGTH + 2 > LOG_BATCH_SIZE)) {
+		flushBatch();
+	}
+	s_BatchLevel = level;
+	memcpy(s_Batch + s_BatchLength, s_LevelStrings[level], s_LevelStringLengths[level]);
+	s_BatchLength += s_LevelStringLengths[level];
+	return s_Batch + s_BatchLength;
+}
+
+void Logger::commitLine(unsigned int length) {
+	s_BatchLength += length;
+	s_Batch[s_BatchLength++] = '\n';
+}
+
+void Logger::flushBatch() {
+	if (s_BatchLength > 0) {
+		s_Batch[s_BatchLength] = '\0';
+		writeToSinks(s_BatchLevel, s_Batch, s_BatchLength);
+		s_BatchLength = 0;
+	}
+}
+
+void Logger::writeMessage(const QueuedLogMessage& slot) {
+	m_LastLevel = slot.s_Level;
+	m_LastFormat = slot.s_Format;
+	m_LastLength = slot.s_Length;
+	m_LastTruncated = slot.s_Truncated;
+	memcpy(m_LastMessage, slot.s_Message, slot.s_Length);
+	m_HasLast = true;
+
+	if (m_BinaryOpen) {
+		writeRecord(slot.s_Level, slot.s_Format, slot.s_Message, slot.s_Length, slot.s_Truncated);
+	}
+	if (!m_BinaryOpen || slot.s_Level >= LOG_BINARY_TEXT_LEVEL) {
+		char* line = reserveLine(slot.s_Level);
+		if (slot.s_Format) {
+			commitLine(formatDeferred(line, LOG_MESSAGE_MAX_LENGTH, slot.s_Format, slot.s_Message, slot.s_Length, slot.s_Truncated));
+		}
+		else {
+			memcpy(line, slot.s_Message, slot.s_Length);
+			commitLine(slot.s_Length);
+		}
+	}
+}
+
+void Logger::writeNotice(LogLevel level, const char* format, ...) {
+	char text[LOG_MESSAGE_MAX_LENGTH];
+	va_list args;
+	va_start(args, format);
+	int length = vsnprintf(text, sizeof(text), format, args);
+	va_end(args);
+	if (length < 0) {
+		return;
+	}
+	if (length >= LOG_MESSAGE_MAX_LENGTH) {
+		length = LOG_MESSAGE_MAX_LENGTH - 1;
+	}
+
+	if (m_BinaryOpen) {
+		writeRecord(level, nullptr, text, (unsigned int)length, false);
+	}
+	if (!m_BinaryOpen || level >= LOG_BINARY_TEXT_LEVEL) {
+		memcpy(reserveLine(level), text, (size_t)length);
+		commitLine((unsigned int)length);
+	}
+}
+
+bool Logger::isRepeat(const QueuedLogMessage& slot) {
+	return m_HasLast
+		&& m_SuppressDuplicates[slot.s_Level].load(std::memory_order_relaxed)
+		&& slot.s_Level == m_LastLevel
+		&& slot.s_Format == m_LastFormat
+		&& slot.s_Length == m_LastLength
+		&& slot.s_Truncated == m_LastTruncated
+		&& memcmp(slot.s_Message, m_LastMessage, slot.s_Length) == 0;
+}
+
+void Logger::reportRepeats() {
+	// The last message stays remembered, so a message that keeps coming is reported once per interval
+	if (m_Repeats > 0) {
+		writeNotice(m_LastLevel, "Last message repeated %llu times.", m_Repeats);
+		m_Repeats = 0;
+	}
+}
+
+void Logger::reportSuppressed() {
+	for (LogSite* site = m_SuppressedSites.load(std::memory_order_acquire); site; site = site->s_Next) {
+		unsigned int suppressed = site->s_Suppressed.exchange(0, std::memory_order_relaxed);
+		if (suppressed > 0) {
+			writeNotice(LOG_LEVEL_WARN, "Rate limit dropped %u messages of \"%s\".", suppressed, site->s_Format);
+		}
+	}
+}
+
+void Logger::writeToSinks(LogLevel level, const char* text, unsigned int length) {
+	unsigned int count = m_SinkCount.load(std::memory_order_acquire);
+	for (unsigned int i = 0; i < count; i++) {
+		m_Sinks[i](level, text, length);
+	}
+}
+
+void Logger::wakeWriter() {
+	std::lock_guard<std::mutex> lock(m_WakeMutex);
+	m_WakeRequested = true;
+	m_Wake.notify_all();
+}
+
+void Logger::writeRecord(LogLevel level, const char* format, const char* payload, unsigned int length, bool truncated) {
+	LogRecordHeader header{};
+	header.s_Kind = format ? LOG_RECORD_MESSAGE : LOG_RECORD_TEXT;
+	header.s_Level = (unsigned char)level;
+	header.s_Truncated = truncated;
+	header.s_Length = length;
+	header.s_Format = format ? getFormatId(format) : 0;
+	writeBinary(&header, sizeof(header));
+	writeBinary(payload, length);
+}
+
+void Logger::writeBinary(const void* data, unsigned int size) {
+	if (s_BinaryLength + size > LOG_BINARY_BUFFER_SIZE) {
+		flushBinary();
+	}
+	memcpy(s_BinaryBuffer + s_BinaryLength, data, size);
+	s_BinaryLength += size;
+}
+
+void Logger::flushBinary() {
+	if (s_BinaryLength > 0 && !m_BinaryFile.Write(s_BinaryBuffer, s_BinaryLength)) {
+		EN_ERROR("Cannot write the binary log, closing it.");
+		m_BinaryFile.Close();
+		m_BinaryOpen = false;
+	}
+	s_BinaryLength = 0;
+}
+
+unsigned long long Logger::getFormatId(const char* format) {
+	unsigned long long hash = ((unsigned long long)(uintptr_t)format >> 3) * 0x9E3779B97F4A7C15ULL;
+	unsigned int index = (unsigned int)(hash >> 40) & (LOG_FORMAT_TABLE_SIZE - 1);
+	for (unsigned int probe = 0; probe < LOG_FORMAT_TABLE_SIZE; probe++) {
+		unsigned int slot = (index + probe) & (LOG_FORMAT_TABLE_SIZE - 1);
+		if (m_FormatKeys[slot] == format) {
+			return m_FormatIds[slot];
+		}
+		if (!m_FormatKeys[slot]) {
+			m_FormatKeys[slot] = format;
+			m_FormatIds[slot] = m_NextFormatId;
+			break;
+		}
+	}
+	// A full table writes the definition again with every message, the file stays decodable
+	unsigned long long id = m_NextFormatId++;
+	LogRecordHeader header{};
+	header.s_Kind = LOG_RECORD_FORMAT;
+	header.s_Length = (unsigned int)strlen(format) + 1;
+	header.s_Format = id;
+	writeBinary(&header, sizeof(header));
+	writeBinary(format, header.s_Length);
+	return id;
+}
+
+// One decoded argument of a deferred message
+struct LogArgument {
+	LogArgumentType s_Type;
+	unsigned long long s_Bits;
+	double s_Double;
+	const char* s_String;
+	unsigned int s_StringLength;
+};
+
+static bool readArgument(const char* arguments, unsigned int length, unsigned int& offset, LogArgument& argument) {
+	if (offset >= length) {
+		return false;
+	}
+	argument.s_Type = (LogArgumentType)arguments[offset];
+	const char* value = arguments + offset + 1;
+	unsigned int size;
+	switch (argument.s_Type) {
+		case LOG_ARGUMENT_INT32:
+		case LOG_ARGUMENT_UINT32: {
+			unsigned int bits;
+			size = sizeof(bits);
+			if (offset + 1 + size > length) {
+				return false;
+			}
+			memcpy(&bits, value, size);
+			// Signed values keep their sign in 64 bits
+			argument.s_Bits = argument.s_Type == LOG_ARGUMENT_INT32 ? (unsigned long long)(long long)(int)bits : bits;
+			break;
+		}
+		case LOG_ARGUMENT_INT64:
+		case LOG_ARGUMENT_UINT64:
+		case LOG_ARGUMENT_POINTER: {
+			size = sizeof(argument.s_Bits);
+			if (offset + 1 + size > length) {
+				return false;
+			}
+			memcpy(&argument.s_Bits, value, size);
+			break;
+		}
+		case LOG_ARGUMENT_DOUBLE: {
+			size = sizeof(argument.s_Double);
+			if (offset + 1 + size > length) {
+				return false;
+			}
+			memcpy(&argument.s_Double, value, size);
+			break;
+		}
+		case LOG_ARGUMENT_STRING: {
+			unsigned short stringLength;
+			if (offset + 1 + sizeof(stringLength) > length) {
+				return false;
+			}
+			memcpy(&stringLength, value, sizeof(stringLength));
+			size = sizeof(stringLength) + stringLength;
+			if (offset + 1 + size > length) {
+				return false;
+			}
+			argument.s_String = value + sizeof(stringLength);
+			argument.s_StringLength = stringLength;
+			break;
+		}
+		default:
+			return false;
+	}
+	offset += 1 + size;
+	return true;
+}
+
+// Formats one argument with the flags, width and precision of the caller's conversion in spec.
+// The length modifier and conversion are picked from the stored type, so a mismatch between
+// the format and the argument prints something sensible instead of reading garbage.
+static int formatArgument(char* out, unsigned int capacity, char* spec, unsigned int specLength, char conversion, const LogArgument& argument) {
+	bool isInteger = argument.s_Type != LOG_ARGUMENT_DOUBLE && argument.s_Type != LOG_ARGUMENT_STRING;
+	switch (argument.s_Type) {
+		case LOG_ARGUMENT_STRING: {
+			char text[LOG_MESSAGE_MAX_LENGTH];
+			memcpy(text, argument.s_String, argument.s_StringLength);
+			text[argument.s_StringLength] = '\0';
+			memcpy(spec + specLength, "s", 2);
+			return snprintf(out, capacity, spec, text);
+		}
+		case LOG_ARGUMENT_DOUBLE: {
+			if (strchr("di", conversion)) {
+				memcpy(spec + specLength, "lld", 4);
+				return snprintf(out, capacity, spec, (long long)argument.s_Double);
+			}
+			spec[specLength] = strchr("fFeEgGaA", conversion) ? conversion : 'g';
+			spec[specLength + 1] = '\0';
+			return snprintf(out, capacity, spec, argument.s_Double);
+		}
+		default:
+			break;
+	}
+	if (isInteger && conversion == 'p') {
+		memcpy(spec + specLength, "p", 2);
+		return snprintf(out, capacity, spec, (void*)(uintptr_t)argument.s_Bits);
+	}
+	if (conversion == 'c') {
+		memcpy(spec + specLength, "c", 2);
+		return snprintf(out, capacity, spec, (int)argument.s_Bits);
+	}
+	if (strchr("fFeEgGaA", conversion)) {
+		spec[specLength] = conversion;
+		spec[specLength + 1] = '\0';
+		double value = argument.s_Type == LOG_ARGUMENT_UINT64 || argument.s_Type == LOG_ARGUMENT_POINTER ? (double)argument.s_Bits : (double)(long long)argument.s_Bits;
+		return snprintf(out, capacity, spec, value);
+	}
+	if (strchr("uxXo", conversion)) {
+		// printf shows a negative int passed to %u as its 32 bit pattern
+		unsigned long long value = argument.s_Type == LOG_ARGUMENT_INT32 ? (unsigned int)argument.s_Bits : argument.s_Bits;
+		spec[specLength] = 'l';
+		spec[specLength + 1] = 'l';
+		spec[specLength + 2] = conversion;
+		spec[specLength + 3] = '\0';
+		return snprintf(out, capacity, spec, value);
+	}
+	if (argument.s_Type == LOG_ARGUMENT_POINTER) {
+		memcpy(spec + specLength, "p", 2);
+		return snprintf(out, capacity, spec, (void*)(uintptr_t)argument.s_Bits);
+	}
+	if (argument.s_Type == LOG_ARGUMENT_UINT64) {
+		memcpy(spec + specLength, "llu", 4);
+		return snprintf(out, capacity, spec, argument.s_Bits);
+	}
+	memcpy(spec + specLength, "lld", 4);
+	return snprintf(out, capacity, spec, (long long)argument.s_Bits);
+}
+
+unsigned int Logger::formatDeferred(char* out, unsigned int capacity, const char* format, const char* arguments, unsigned int length, bool truncated) {
+	unsigned int written = 0;
+	unsigned int offset = 0;
+	const char* c = format;
+	while (*c && written + 1 < capacity) {
+		if (*c != '%') {
+			out[written++] = *c++;
+			continue;
+		}
+		if (c[1] == '%') {
+			out[written++] = '%';
+			c += 2;
+			continue;
+		}
+
+		// Flags, width and precision are kept, * takes its value from the arguments
+		char spec[64];
+		unsigned int specLength = 0;
+		spec[specLength++] = *c++;
+		while (*c && strchr("-+ #0", *c) && specLength < 8) {
+			spec[specLength++] = *c++;
+		}
+		for (int part = 0; part < 2; part++) {
+			if (part == 1) {
+				if (*c != '.') {
+					break;
+				}
+				spec[specLength++] = *c++;
+			}
+			if (*c == '*') {
+				LogArgument star;
+				int value = readArgument(arguments, length, offset, star) ? (int)star.s_Bits : 0;
+				specLength += snprintf(spec + specLength, 12, "%d", value);
+				c++;
+			}
+			else {
+				while (*c >= '0' && *c <= '9' && specLength < 32) {
+					spec[specLength++] = *c++;
+				}
+			}
+		}
+		while (*c && strchr("hlLqjzt", *c)) {
+			c++;
+		}
+		char conversion = *c;
+		if (!conversion) {
+			break;
+		}
+		c++;
+		if (conversion == 'n') {
+			continue;
+		}
+
+		LogArgument argument;
+		int result;
+		if (readArgument(arguments, length, offset, argument)) {
+			result = formatArgument(out + written, capacity - written, spec, specLength, conversion, argument);
+		}
+		else {
+			result = snprintf(out + written, capacity - written, "%s", truncated ? "<truncated>" : "<missing>");
+		}
+		if (result > 0) {
+			written += (unsigned int)result < capacity - written ? (unsigned int)result : capacity - written - 1;
+		}
+	}
+	out[written] = '\0';
+	return written;
+}
+
+bool Logger::DecodeBinaryLog(const char* path, FILE* out) {
+	File file;
+	if (!file.Open(path, FILE_MODE_READ, true)) {
+		return false;
+	}
+	unsigned int size = file.Size();
+	char* data = (char*)malloc(size ? size : 1);
+	if (!data || !file.ReadAllBytes(data)) {
+		free(data);
+		file.Close();
+		return false;
+	}
+	file.Close();
+
+	LogFileHeader fileHeader;
+	if (size < sizeof(fileHeader) || (memcpy(&fileHeader, data, sizeof(fileHeader)), fileHeader.s_Magic != LOG_FILE_MAGIC || fileHeader.s_Version != LOG_FILE_VERSION)) {
+		EN_ERROR("'%s' is not a binary log of this version.", path);
+		free(data);
+		return false;
+	}
+
+	// Ids are handed out in order, so the highest id is at most the number of definitions
+	unsigned long long formatCount = 0;
+	for (unsigned long long offset = sizeof(fileHeader); offset + sizeof(LogRecordHeader) <= size;) {
+		LogRecordHeader header;
+		memcpy(&header, data + offset, sizeof(header));
+		formatCount += header.s_Kind == LOG_RECORD_FORMAT;
+		offset += sizeof(header) + (unsigned long long)header.s_Length;
+	}
+	const char** formats = (const char**)calloc((size_t)formatCount + 1, sizeof(const char*));
+
+	char text[LOG_MESSAGE_MAX_LENGTH];
+	unsigned int offset = sizeof(fileHeader);
+	while (offset + sizeof(LogRecordHeader) <= size) {
+		LogRecordHeader header;
+		memcpy(&header, data + offset, sizeof(header));
+		const char* payload = data + offset + sizeof(header);
+		if (header.s_Length > size - offset - sizeof(header)) {
+			// The writer died in the middle of this record
+			EN_WARN("Binary log '%s' ends in a partial record.", path);
+			break;
+		}
+		offset += sizeof(header) + header.s_Length;
+
+		const char* level = header.s_Level <= LOG_LEVEL_FATAL ? s_LevelStrings[header.s_Level] : "[?]: ";
+		switch (header.s_Kind) {
+			case LOG_RECORD_FORMAT: {
+				if (header.s_Format <= formatCount && header.s_Length > 0 && payload[header.s_Length - 1] == '\0') {
+					formats[header.s_Format] = payload;
+				}
+				break;
+			}
+			case LOG_RECORD_MESSAGE: {
+				const char* format = header.s_Format <= formatCount ? formats[header.s_Format] : nullptr;
+				if (!format) {
+					fprintf(out, "%s<unknown format %llu>\n", level, header.s_Format);
+					break;
+				}
+				formatDeferred(text, sizeof(text), format, payload, header.s_Length, header.s_Truncated != 0);
+				fprintf(out, "%s%s\n", level, text);
+				break;
+			}
+			case LOG_RECORD_TEXT: {
+				fprintf(out, "%s%.*s\n", level, (int)header.s_Length, payload);
+				break;
+			}
+		}
+	}
+
+	free(formats);
+	free(data);
+	return true;
+}
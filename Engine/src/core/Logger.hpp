@@ -1,4 +1,34 @@
 #pragma once
+#include <stdarg.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+#include "File.hpp"
+
+// Messages that can wait for the writer thread, has to be a power of two
+#define LOG_QUEUE_CAPACITY 1024
+// Longest message or argument record kept, longer ones are cut off
+#define LOG_MESSAGE_MAX_LENGTH 992
+#define LOG_MAX_SINKS 4
+// Longest time a message waits in the queue when nobody flushes
+#define LOG_WRITER_INTERVAL_MS 4
+// Longest time Flush waits for the writer, so a stuck sink cannot hang a crash
+#define LOG_FLUSH_TIMEOUT_MS 500
+// Format strings the writer remembers as already written to the binary log, has to be a power of two
+#define LOG_FORMAT_TABLE_SIZE 4096
+// While a binary log is open only messages from this level on are formatted for the sinks
+#define LOG_BINARY_TEXT_LEVEL LOG_LEVEL_WARN
+// Messages one call site may log per second and level unless SetRateLimit says otherwise
+#define LOG_DEFAULT_RATE_LIMIT 50
+// How often suppressed and repeated message counts are reported
+#define LOG_REPORT_INTERVAL_MS 1000
+#define LOG_FILE_MAGIC 0x474C4E45
+#define LOG_FILE_VERSION 1
 
 enum LogLevel {
 	LOG_LEVEL_TRACE,
@@ -9,19 +39,283 @@ enum LogLevel {
 	LOG_LEVEL_FATAL,
 };
 
+// EN_* calls below this level are compiled out, arguments included
+#ifndef LOG_MIN_LEVEL
+#ifdef _DEBUG
+#define LOG_MIN_LEVEL LOG_LEVEL_TRACE
+#else
+#define LOG_MIN_LEVEL LOG_LEVEL_WARN
+#endif
+#endif
+
+// Tags in front of every argument of a deferred message
+enum LogArgumentType {
+	LOG_ARGUMENT_INT32,
+	LOG_ARGUMENT_UINT32,
+	LOG_ARGUMENT_INT64,
+	LOG_ARGUMENT_UINT64,
+	LOG_ARGUMENT_DOUBLE,
+	LOG_ARGUMENT_POINTER,
+	// 16 bit length followed by the characters, not null terminated
+	LOG_ARGUMENT_STRING,
+};
+
+// Receives formatted text on the writer thread. Consecutive messages of the same level
+// arrive in one call, every message ends with a newline and text is null terminated.
+typedef void (*pfnLogSink)(LogLevel level, const char* text, unsigned int length);
+
+struct alignas(64) QueuedLogMessage {
+	std::atomic<unsigned long long> s_Sequence;
+	// Format of a deferred message with its arguments in s_Message, nullptr if s_Message is text
+	const char* s_Format;
+	LogLevel s_Level;
+	unsigned int s_Length;
+	// Arguments did not fit, the ones after the last encoded one are missing
+	bool s_Truncated;
+	char s_Message[LOG_MESSAGE_MAX_LENGTH];
+};
+
+// State of one EN_* call site, the macros keep one in a function local static
+struct LogSite {
+	// Start of the current rate limit window, steady clock milliseconds
+	std::atomic<unsigned long long> s_WindowStart;
+	std::atomic<unsigned int> s_Count;
+	// Messages the rate limit dropped since the last report
+	std::atomic<unsigned int> s_Suppressed;
+	// Set once the site is on the list the writer reports from
+	std::atomic<bool> s_Listed;
+	const char* s_Format;
+	LogSite* s_Next;
+};
+
+enum LogRecordKind {
+	// Payload is a null terminated format string, s_Format is the id messages refer to it by
+	LOG_RECORD_FORMAT,
+	// Payload is the arguments of the format with id s_Format
+	LOG_RECORD_MESSAGE,
+	// Payload is text that was formatted by the caller
+	LOG_RECORD_TEXT,
+};
+
+struct LogFileHeader {
+	unsigned int s_Magic;
+	unsigned int s_Version;
+};
+
+struct LogRecordHeader {
+	unsigned char s_Kind;
+	unsigned char s_Level;
+	unsigned char s_Truncated;
+	unsigned char s_Reserved;
+	unsigned int s_Length;
+	unsigned long long s_Format;
+};
+
+// The EN_* macros capture the format pointer and the raw arguments into a slot of a lock free
+// queue, a writer thread started by Initialize formats them and hands batches to the sinks.
+// With a binary log open the writer stores the records as they are instead and only formats
+// the important ones, DecodeBinaryLog turns such a file into text later.
+// Every call site has a per level rate limit, and a message identical to the one before it
+// is collapsed into a repeat count. Both counts are reported once per LOG_REPORT_INTERVAL_MS.
+// Before Initialize and after Shutdown messages are written on the calling thread.
+// FATAL messages flush before returning.
 class Logger {
 public:
-	static void Initialize(unsigned int logLevel);
+	// binaryLogPath is optional, every message ends up in that file unformatted
+	static void Initialize(unsigned int logLevel, const char* binaryLogPath = nullptr);
+	// Writes everything still queued and stops the writer thread
+	static void Shutdown();
+	// Formats on the calling thread, for format strings that are not literals
 	static void LogMessage(LogLevel level, const char* message, ...);
+	// Format has to outlive the writer thread, the EN_* macros only accept literals
+	template<typename... Args>
+	static void Log(LogSite& site, LogLevel level, const char* format, const Args&... args);
+	// Blocks until every message logged before the call reached the sinks, at most LOG_FLUSH_TIMEOUT_MS
+	static void Flush();
+	// The console sink is always the first, sinks cannot be removed
+	static bool AddSink(pfnLogSink sink);
 	static unsigned int GetLogLevel() { return m_LogLevel; }
 	static void SetLogLevel(unsigned int level) { m_LogLevel = level; }
+	// Messages lost because the queue was full
+	static unsigned long long GetDroppedMessages() { return m_Dropped.load(std::memory_order_relaxed); }
+	// Messages per second a single call site may log at level, 0 turns the limit off
+	static void SetRateLimit(LogLevel level, unsigned int messagesPerSecond) { m_RateLimits[level].store(messagesPerSecond, std::memory_order_relaxed); }
+	// Whether a message equal to the one before it is collapsed into "repeated N times"
+	static void SetDuplicateSuppression(LogLevel level, bool enabled) { m_SuppressDuplicates[level].store(enabled, std::memory_order_relaxed); }
+
+	// Writes a binary log as text, one message per line
+	static bool DecodeBinaryLog(const char* path, FILE* out);
 private:
+	// Returns nullptr with queued false if the message has to be written on the calling thread,
+	// and nullptr with queued true if the queue is full and the message was dropped
+	static QueuedLogMessage* claimSlot(LogLevel level, unsigned long long& position, bool& queued);
+	static void publish(QueuedLogMessage* slot, unsigned long long position);
+	// Counts the message against the rate limit of its site, false if it has to be dropped
+	static bool checkRate(LogSite& site, LogLevel level, const char* format);
+	static void writeDirect(LogLevel level, const char* message, va_list args);
+	static void writerMain();
+	// Writes what is queued, returns the number of messages written
+	static unsigned int drain();
+	static void writeToSinks(LogLevel level, const char* text, unsigned int length);
+	static void wakeWriter();
+
+	// Batch of text for the sinks, reserveLine returns room for LOG_MESSAGE_MAX_LENGTH characters
+	static char* reserveLine(LogLevel level);
+	static void commitLine(unsigned int length);
+	static void flushBatch();
+	static void writeMessage(const QueuedLogMessage& slot);
+	// Text the writer produces itself, like repeat counts
+	static void writeNotice(LogLevel level, const char* format, ...);
+	static bool isRepeat(const QueuedLogMessage& slot);
+	static void reportRepeats();
+	static void reportSuppressed();
+
+	// Format nullptr writes payload as text
+	static void writeRecord(LogLevel level, const char* format, const char* payload, unsigned int length, bool truncated);
+	static void writeBinary(const void* data, unsigned int size);
+	static void flushBinary();
+	// Id of a format string in the binary log, writes its definition the first time
+	static unsigned long long getFormatId(const char* format);
+	// Formats the arguments of a deferred message, returns the length written to out
+	static unsigned int formatDeferred(char* out, unsigned int capacity, const char* format, const char* arguments, unsigned int length, bool truncated);
+
+	template<typename T>
+	static bool encodeValue(char* buffer, unsigned int& length, LogArgumentType type, T value);
+	static bool encodeString(char* buffer, unsigned int& length, const char* value);
+	template<typename T>
+	static bool encodeArgument(char* buffer, unsigned int& length, const T& value);
+
 	static unsigned int m_LogLevel;
+
+	static QueuedLogMessage m_Queue[LOG_QUEUE_CAPACITY];
+	alignas(64) static std::atomic<unsigned long long> m_QueueHead;
+	alignas(64) static std::atomic<unsigned long long> m_QueueTail;
+	static std::atomic<unsigned long long> m_Dropped;
+
+	static pfnLogSink m_Sinks[LOG_MAX_SINKS];
+	static std::atomic<unsigned int> m_SinkCount;
+
+	static std::thread m_Writer;
+	// Published before m_Running, producers compare against it to find the writer thread
+	static std::atomic<std::thread::id> m_WriterId;
+	static std::atomic<bool> m_Running;
+	static std::atomic<bool> m_StopWriter;
+	static std::mutex m_WakeMutex;
+	static std::condition_variable m_Wake;
+	static bool m_WakeRequested;
+
+	// Writer thread only
+	static File m_BinaryFile;
+	static bool m_BinaryOpen;
+	static const char* m_FormatKeys[LOG_FORMAT_TABLE_SIZE];
+	static unsigned long long m_FormatIds[LOG_FORMAT_TABLE_SIZE];
+	static unsigned long long m_NextFormatId;
+
+	static std::atomic<unsigned int> m_RateLimits[LOG_LEVEL_FATAL + 1];
+	static std::atomic<bool> m_SuppressDuplicates[LOG_LEVEL_FATAL + 1];
+	// Sites that hit their rate limit at least once
+	static std::atomic<LogSite*> m_SuppressedSites;
+
+	// Last message written and how often it came again since, writer thread only
+	static LogLevel m_LastLevel;
+	static const char* m_LastFormat;
+	static unsigned int m_LastLength;
+	static bool m_LastTruncated;
+	static bool m_HasLast;
+	static char m_LastMessage[LOG_MESSAGE_MAX_LENGTH];
+	static unsigned long long m_Repeats;
 };
 
-#define EN_TRACE(message, ...) Logger::LogMessage(LOG_LEVEL_TRACE, message, ##__VA_ARGS__)
-#define EN_INFO(message, ...) Logger::LogMessage(LOG_LEVEL_INFO, message, ##__VA_ARGS__)
-#define EN_DEBUG(message, ...) Logger::LogMessage(LOG_LEVEL_DEBUG, message, ##__VA_ARGS__)
-#define EN_WARN(message, ...) Logger::LogMessage(LOG_LEVEL_WARN, message, ##__VA_ARGS__)
-#define EN_ERROR(message, ...) Logger::LogMessage(LOG_LEVEL_ERROR, message, ##__VA_ARGS__)
-#define EN_FATAL(message, ...) Logger::LogMessage(LOG_LEVEL_FATAL, message, ##__VA_ARGS__)
\ No newline at end of file
+template<typename... Args>
+void Logger::Log(LogSite& site, LogLevel level, const char* format, const Args&... args) {
+	if (m_LogLevel > (unsigned int)level || !checkRate(site, level, format)) {
+		return;
+	}
+	unsigned long long position;
+	bool queued;
+	QueuedLogMessage* slot = claimSlot(level, position, queued);
+	if (!queued) {
+		LogMessage(level, format, args...);
+		return;
+	}
+	if (slot) {
+		slot->s_Format = format;
+		slot->s_Level = level;
+		slot->s_Length = 0;
+		// Stops at the first argument that does not fit
+		slot->s_Truncated = !(encodeArgument(slot->s_Message, slot->s_Length, args) && ...);
+		publish(slot, position);
+	}
+	if (level == LOG_LEVEL_FATAL) {
+		Flush();
+	}
+}
+
+template<typename T>
+bool Logger::encodeValue(char* buffer, unsigned int& length, LogArgumentType type, T value) {
+	if (length + 1 + sizeof(T) > LOG_MESSAGE_MAX_LENGTH) {
+		return false;
+	}
+	buffer[length] = (char)type;
+	memcpy(buffer + length + 1, &value, sizeof(T));
+	length += 1 + sizeof(T);
+	return true;
+}
+
+inline bool Logger::encodeString(char* buffer, unsigned int& length, const char* value) {
+	if (!value) {
+		value = "(null)";
+	}
+	if (length + 3 > LOG_MESSAGE_MAX_LENGTH) {
+		return false;
+	}
+	unsigned int available = LOG_MESSAGE_MAX_LENGTH - length - 3;
+	unsigned int size = (unsigned int)strnlen(value, available + 1);
+	bool complete = size <= available;
+	if (!complete) {
+		size = available;
+	}
+	unsigned short stored = (unsigned short)size;
+	buffer[length] = (char)LOG_ARGUMENT_STRING;
+	memcpy(buffer + length + 1, &stored, sizeof(stored));
+	memcpy(buffer + length + 3, value, size);
+	length += 3 + size;
+	return complete;
+}
+
+template<typename T>
+bool Logger::encodeArgument(char* buffer, unsigned int& length, const T& value) {
+	typedef std::decay_t<T> Type;
+	if constexpr (std::is_same_v<Type, char*> || std::is_same_v<Type, const char*>) {
+		return encodeString(buffer, length, value);
+	}
+	else if constexpr (std::is_pointer_v<Type> || std::is_null_pointer_v<Type>) {
+		return encodeValue(buffer, length, LOG_ARGUMENT_POINTER, (unsigned long long)(uintptr_t)(const void*)value);
+	}
+	else if constexpr (std::is_enum_v<Type>) {
+		return encodeArgument(buffer, length, (std::underlying_type_t<Type>)value);
+	}
+	else if constexpr (std::is_floating_point_v<Type>) {
+		return encodeValue(buffer, length, LOG_ARGUMENT_DOUBLE, (double)value);
+	}
+	else {
+		static_assert(std::is_integral_v<Type>, "Log arguments have to be numbers, enums, pointers or strings.");
+		if constexpr (sizeof(Type) <= 4) {
+			return encodeValue(buffer, length, std::is_signed_v<Type> ? LOG_ARGUMENT_INT32 : LOG_ARGUMENT_UINT32, (unsigned int)value);
+		}
+		else {
+			return encodeValue(buffer, length, std::is_signed_v<Type> ? LOG_ARGUMENT_INT64 : LOG_ARGUMENT_UINT64, (unsigned long long)value);
+		}
+	}
+}
+
+// The "" in front of the format only compiles for string literals, which outlive the writer thread.
+// The site is constant initialized, so it costs no guard.
+#define EN_LOG(level, message, ...) do { if constexpr (level >= LOG_MIN_LEVEL) { static LogSite s_LogSite; Logger::Log(s_LogSite, level, "" message, ##__VA_ARGS__); } } while (0)
+
+#define EN_TRACE(message, ...) EN_LOG(LOG_LEVEL_TRACE, message, ##__VA_ARGS__)
+#define EN_INFO(message, ...) EN_LOG(LOG_LEVEL_INFO, message, ##__VA_ARGS__)
+#define EN_DEBUG(message, ...) EN_LOG(LOG_LEVEL_DEBUG, message, ##__VA_ARGS__)
+#define EN_WARN(message, ...) EN_LOG(LOG_LEVEL_WARN, message, ##__VA_ARGS__)
+#define EN_ERROR(message, ...) EN_LOG(LOG_LEVEL_ERROR, message, ##__VA_ARGS__)
+#define EN_FATAL(message, ...) EN_LOG(LOG_LEVEL_FATAL, message, ##__VA_ARGS__)
@@ -1,53 +1,455 @@
 #include <stdlib.h>
+#include <chrono>
 
 #include "Memory.hpp"
+#include "MemoryKernels.hpp"
+#include "PoolAllocator.hpp"
+#include "StackAllocator.hpp"
 #include "Logger.hpp"
 
 const char* Memory::m_MemoryTagStrings[MEMORY_TAG_MAX] = {
 	 "MEMORY_TAG_ARRAY",
-	 "MEMORY_TAG_std::vector",
+	 "MEMORY_TAG_DARRAY",
 	 "MEMORY_TAG_TEXTURE",
 	 "MEMORY_TAG_MESH",
-	 "MEMORY_TAG_RENDERER"
+	 "MEMORY_TAG_RENDERER",
+	 "MEMORY_TAG_FRAME",
+	 "MEMORY_TAG_LOAD"
 	};
 
-unsigned long Memory::m_Capacity;
-AllocationStats Memory::m_Stats;
+unsigned long long Memory::m_Capacity;
+MemoryThreadStats Memory::m_ThreadStats[MAX_MEMORY_STAT_THREADS];
+MemoryThreadStats Memory::m_SharedStats;
+std::mutex Memory::m_StatsMutex;
+unsigned long long Memory::m_PeakBytes[MEMORY_TAG_MAX];
+unsigned long long Memory::m_TotalPeakBytes;
+MemoryStats Memory::m_LastUpdate;
+unsigned long long Memory::m_LastAllocatedBytes[MEMORY_TAG_MAX];
+unsigned long long Memory::m_LastUpdateTime;
+unsigned int Memory::m_StatsDumpInterval;
+unsigned long long Memory::m_FrameNumber;
+VirtualRange Memory::m_HeapRange;
+HeapAllocator Memory::m_Heap;
+std::mutex Memory::m_GrowMutex;
+LinearAllocator Memory::m_FrameAllocator;
+unsigned long long Memory::m_LastFrameAllocated;
+StackAllocator Memory::m_LoadStack;
+PoolAllocatorBase* Memory::m_Pools[MAX_MEMORY_POOLS];
+unsigned int Memory::m_PoolCount;
 
-// TODO implement dynamic allocator
-void* Memory::Allocate(unsigned int size, MemoryTag tag) {
-	m_Stats.s_TotalAllocations++;
-	m_Stats.s_MemoryAllocationStats[tag] += size;
-	//EN_DEBUG("Allocate size: %d, TotalAllocations: %d.", size, m_Stats.s_TotalAllocations);
-	return malloc(size);
+// Hands every thread its own counters on first use and gives them back when the thread exits
+struct MemoryThreadStatsHandle {
+	MemoryThreadStats* s_Stats = nullptr;
+
+	~MemoryThreadStatsHandle() {
+		if (s_Stats) {
+			Memory::releaseThreadStats(s_Stats);
+		}
+	}
+
+	MemoryThreadStats* Get() {
+		if (!s_Stats) {
+			s_Stats = Memory::acquireThreadStats();
+		}
+		return s_Stats;
+	}
+};
+
+static thread_local MemoryThreadStatsHandle threadStats;
+
+// Counters owned by one thread are updated without a locked instruction,
+// the shared counters can be written by several threads at once
+template<typename T>
+static void addToCounter(std::atomic<T>& counter, T value, bool shared) {
+	if (shared) {
+		counter.fetch_add(value, std::memory_order_relaxed);
+	}
+	else {
+		counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+	}
+}
+
+static unsigned long long clampToZero(long long value) {
+	return value > 0 ? (unsigned long long)value : 0;
+}
+
+static unsigned long long nowNanoseconds() {
+	return (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+LinearAllocator::~LinearAllocator() {
+	Destroy();
+}
+
+bool LinearAllocator::Create(unsigned long long capacity, MemoryTag tag) {
+	if (m_Memory) {
+		EN_WARN("LinearAllocator::Create was called on an allocator that already owns memory.");
+		return false;
+	}
+	m_Memory = (char*)Memory::Allocate(capacity, tag);
+	if (!m_Memory) {
+		EN_ERROR("LinearAllocator could not reserve %llu bytes.", capacity);
+		return false;
+	}
+	m_Capacity = capacity;
+	m_Offset = 0;
+	m_HighWaterMark = 0;
+	m_Tag = tag;
+	return true;
+}
+
+void LinearAllocator::Destroy() {
+	if (m_Memory) {
+		Memory::Free(m_Memory, m_Capacity, m_Tag);
+		m_Memory = nullptr;
+	}
+	m_Capacity = 0;
+	m_Offset = 0;
+}
+
+void* LinearAllocator::Allocate(unsigned long long size, unsigned long long alignment) {
+	// Alignment has to be a power of two
+	unsigned long long aligned = (m_Offset + alignment - 1) & ~(alignment - 1);
+	if (!m_Memory || aligned + size > m_Capacity) {
+		EN_ERROR("LinearAllocator is out of memory. Requested %llu bytes, %llu of %llu in use.", size, m_Offset, m_Capacity);
+		return nullptr;
+	}
+	m_Offset = aligned + size;
+	if (m_Offset > m_HighWaterMark) {
+		m_HighWaterMark = m_Offset;
+	}
+	return m_Memory + aligned;
+}
+
+void LinearAllocator::Reset() {
+	m_Offset = 0;
+}
+
+bool Memory::Initialize(const MemoryConfig& config) {
+	MemoryKernels::Initialize();
+
+	// Reserve the address space for the whole engine heap at once, but only commit
+	// the initial part. Everything allocated before this point came from the system
+	// heap and is still freed there.
+	unsigned long long initialCommit = config.s_HeapInitialCommitSize;
+	if (initialCommit == 0 || initialCommit > config.s_HeapSize) {
+		initialCommit = config.s_HeapSize;
+	}
+	if (!VirtualMemory::Reserve(m_HeapRange, config.s_HeapSize, config.s_HeapPageMode)
+		|| !VirtualMemory::Commit(m_HeapRange, initialCommit)
+		|| !m_Heap.Create(m_HeapRange.s_Base, m_HeapRange.s_Committed)) {
+		EN_ERROR("Failed to reserve %llu bytes for the engine heap.", config.s_HeapSize);
+		VirtualMemory::Release(m_HeapRange);
+		return false;
+	}
+	m_Capacity = m_HeapRange.s_Reserved;
+
+	if (!m_FrameAllocator.Create(config.s_FrameAllocatorSize, MEMORY_TAG_FRAME)) {
+		EN_ERROR("Failed to create the frame allocator.");
+		return false;
+	}
+	m_LastFrameAllocated = 0;
+
+	if (config.s_LoadStackSize > 0 && !m_LoadStack.Create(config.s_LoadStackSize, MEMORY_TAG_LOAD)) {
+		EN_ERROR("Failed to create the load stack.");
+		return false;
+	}
+	m_StatsDumpInterval = config.s_StatsDumpInterval;
+	return true;
+}
+
+void Memory::Shutdown() {
+	// Pools outlive main as statics, their chunks have to go back before the heap does
+	for (unsigned int i = 0; i < m_PoolCount; i++) {
+		m_Pools[i]->Release();
+	}
+	m_FrameAllocator.Destroy();
+	m_LoadStack.Destroy();
+
+	m_Heap.Destroy();
+	VirtualMemory::Release(m_HeapRange);
+	m_Capacity = 0;
+}
+
+void* Memory::Allocate(unsigned long long size, MemoryTag tag) {
+	MemoryThreadStats* stats = threadStats.Get();
+	bool shared = stats == &m_SharedStats;
+	addToCounter<long long>(stats->s_Bytes[tag], (long long)size, shared);
+	addToCounter<long long>(stats->s_LiveAllocations[tag], 1, shared);
+	addToCounter<unsigned long long>(stats->s_AllocatedBytes[tag], size, shared);
+	addToCounter<unsigned long long>(stats->s_Allocations[tag], 1, shared);
+
+	void* block = m_Heap.Allocate(size);
+	if (!block && m_Heap.IsCreated()) {
+		block = allocateGrowing(size);
+	}
+	if (!block) {
+		// Heap exhausted (or not yet created), fall back to the system heap
+		addToCounter<unsigned long long>(stats->s_FallbackAllocations, 1, shared);
+		block = malloc((size_t)size);
+	}
+	return block;
+}
+
+void Memory::Free(void* block, unsigned long long size, MemoryTag tag) {
+	// Blocks freed on another thread than they were allocated on leave one
+	// thread's counters negative, the sum over all threads stays right
+	MemoryThreadStats* stats = threadStats.Get();
+	bool shared = stats == &m_SharedStats;
+	addToCounter<long long>(stats->s_Bytes[tag], -(long long)size, shared);
+	addToCounter<long long>(stats->s_LiveAllocations[tag], -1, shared);
+	if (m_Heap.Owns(block)) {
+		m_Heap.Free(block);
+	}
+	else {
+		free(block);
+	}
+}
+
+void* Memory::allocateGrowing(unsigned long long size) {
+	std::lock_guard<std::mutex> lock(m_GrowMutex);
+	// Another thread may have grown the heap while this one waited
+	void* block = m_Heap.Allocate(size);
+	if (block) {
+		return block;
+	}
+
+	// Leave room for block headers and commit in large steps to keep the number of calls into the OS low
+	unsigned long long step = size + 4 * HEAP_ALIGNMENT;
+	if (step < MEMORY_HEAP_COMMIT_STEP) {
+		step = MEMORY_HEAP_COMMIT_STEP;
+	}
+	unsigned long long committed = m_HeapRange.s_Committed;
+	unsigned long long target = committed + step;
+	if (target > m_HeapRange.s_Reserved) {
+		target = m_HeapRange.s_Reserved;
+	}
+	if (target <= committed || !VirtualMemory::Commit(m_HeapRange, target)) {
+		return nullptr;
+	}
+	if (!m_Heap.Extend(m_HeapRange.s_Committed - committed)) {
+		return nullptr;
+	}
+	return m_Heap.Allocate(size);
+}
+
+void* Memory::AllocateFrame(unsigned long long size, unsigned long long alignment) {
+	return m_FrameAllocator.Allocate(size, alignment);
+}
+
+void Memory::ResetFrame() {
+	m_LastFrameAllocated = m_FrameAllocator.GetAllocated();
+	m_FrameAllocator.Reset();
+
+	UpdateStats();
+	m_FrameNumber++;
+	if (m_StatsDumpInterval > 0 && m_FrameNumber % m_StatsDumpInterval == 0) {
+		PrintMemoryStats();
+	}
+}
+
+MemoryThreadStats* Memory::acquireThreadStats() {
+	for (unsigned int i = 0; i < MAX_MEMORY_STAT_THREADS; i++) {
+		bool expected = false;
+		if (!m_ThreadStats[i].s_InUse.load(std::memory_order_relaxed)
+			&& m_ThreadStats[i].s_InUse.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+			return &m_ThreadStats[i];
+		}
+	}
+	return &m_SharedStats;
+}
+
+void Memory::releaseThreadStats(MemoryThreadStats* stats) {
+	if (stats == &m_SharedStats) {
+		return;
+	}
+	// Fold the counters into the shared ones so the slot can be reused by a new thread
+	for (unsigned int tag = 0; tag < MEMORY_TAG_MAX; tag++) {
+		m_SharedStats.s_Bytes[tag].fetch_add(stats->s_Bytes[tag].exchange(0), std::memory_order_relaxed);
+		m_SharedStats.s_LiveAllocations[tag].fetch_add(stats->s_LiveAllocations[tag].exchange(0), std::memory_order_relaxed);
+		m_SharedStats.s_AllocatedBytes[tag].fetch_add(stats->s_AllocatedBytes[tag].exchange(0), std::memory_order_relaxed);
+		m_SharedStats.s_Allocations[tag].fetch_add(stats->s_Allocations[tag].exchange(0), std::memory_order_relaxed);
+	}
+	m_SharedStats.s_FallbackAllocations.fetch_add(stats->s_FallbackAllocations.exchange(0), std::memory_order_relaxed);
+	stats->s_InUse.store(false, std::memory_order_release);
+}
+
+MemoryStats Memory::mergeStats() {
+	long long bytes[MEMORY_TAG_MAX] = {};
+	long long liveAllocations[MEMORY_TAG_MAX] = {};
+	MemoryStats stats{};
+
+	for (unsigned int i = 0; i <= MAX_MEMORY_STAT_THREADS; i++) {
+		const MemoryThreadStats& thread = i < MAX_MEMORY_STAT_THREADS ? m_ThreadStats[i] : m_SharedStats;
+		for (unsigned int tag = 0; tag < MEMORY_TAG_MAX; tag++) {
+			bytes[tag] += thread.s_Bytes[tag].load(std::memory_order_relaxed);
+			liveAllocations[tag] += thread.s_LiveAllocations[tag].load(std::memory_order_relaxed);
+			stats.s_Tags[tag].s_TotalAllocations += thread.s_Allocations[tag].load(std::memory_order_relaxed);
+		}
+		stats.s_FallbackAllocations += thread.s_FallbackAllocations.load(std::memory_order_relaxed);
+	}
+
+	for (unsigned int tag = 0; tag < MEMORY_TAG_MAX; tag++) {
+		MemoryTagStats& tagStats = stats.s_Tags[tag];
+		tagStats.s_CurrentBytes = clampToZero(bytes[tag]);
+		tagStats.s_LiveAllocations = clampToZero(liveAllocations[tag]);
+		if (tagStats.s_CurrentBytes > m_PeakBytes[tag]) {
+			m_PeakBytes[tag] = tagStats.s_CurrentBytes;
+		}
+		tagStats.s_PeakBytes = m_PeakBytes[tag];
+		tagStats.s_AllocationsPerSecond = m_LastUpdate.s_Tags[tag].s_AllocationsPerSecond;
+		tagStats.s_BytesPerSecond = m_LastUpdate.s_Tags[tag].s_BytesPerSecond;
+
+		stats.s_CurrentBytes += tagStats.s_CurrentBytes;
+		stats.s_LiveAllocations += tagStats.s_LiveAllocations;
+	}
+	if (stats.s_CurrentBytes > m_TotalPeakBytes) {
+		m_TotalPeakBytes = stats.s_CurrentBytes;
+	}
+	stats.s_PeakBytes = m_TotalPeakBytes;
+	return stats;
 }
 
-void Memory::Free(void* block, unsigned int size, MemoryTag tag) {
-	m_Stats.s_TotalAllocations--;
-	m_Stats.s_MemoryAllocationStats[tag] -= size;
-	//EN_DEBUG("Free size: %d, TotalAllocations: %d.", size, m_Stats.s_TotalAllocations);
-	free(block);
+MemoryStats Memory::GetStats() {
+	std::lock_guard<std::mutex> lock(m_StatsMutex);
+	return mergeStats();
 }
 
-void Memory::ZeroOut(void* block, int size) {
-	memset(block, 0, size);
+void Memory::UpdateStats() {
+	std::lock_guard<std::mutex> lock(m_StatsMutex);
+	MemoryStats stats = mergeStats();
+
+	// Allocated bytes are only needed for the rate, sum them here instead of in every merge
+	unsigned long long allocatedBytes[MEMORY_TAG_MAX] = {};
+	for (unsigned int i = 0; i <= MAX_MEMORY_STAT_THREADS; i++) {
+		const MemoryThreadStats& thread = i < MAX_MEMORY_STAT_THREADS ? m_ThreadStats[i] : m_SharedStats;
+		for (unsigned int tag = 0; tag < MEMORY_TAG_MAX; tag++) {
+			allocatedBytes[tag] += thread.s_AllocatedBytes[tag].load(std::memory_order_relaxed);
+		}
+	}
+
+	unsigned long long now = nowNanoseconds();
+	if (m_LastUpdateTime > 0 && now > m_LastUpdateTime) {
+		double seconds = (double)(now - m_LastUpdateTime) / 1e9;
+		for (unsigned int tag = 0; tag < MEMORY_TAG_MAX; tag++) {
+			stats.s_Tags[tag].s_AllocationsPerSecond = (double)(stats.s_Tags[tag].s_TotalAllocations - m_LastUpdate.s_Tags[tag].s_TotalAllocations) / seconds;
+			stats.s_Tags[tag].s_BytesPerSecond = (double)(allocatedBytes[tag] - m_LastAllocatedBytes[tag]) / seconds;
+		}
+	}
+	for (unsigned int tag = 0; tag < MEMORY_TAG_MAX; tag++) {
+		m_LastAllocatedBytes[tag] = allocatedBytes[tag];
+	}
+	m_LastUpdate = stats;
+	m_LastUpdateTime = now;
+}
+
+StackAllocator& Memory::GetLoadStack() {
+	return m_LoadStack;
+}
+
+void Memory::RegisterPool(PoolAllocatorBase* pool) {
+	if (m_PoolCount >= MAX_MEMORY_POOLS) {
+		EN_WARN("Memory::RegisterPool could not register pool '%s' because no slots were available.", pool->GetName());
+		return;
+	}
+	m_Pools[m_PoolCount++] = pool;
+}
+
+void Memory::UnregisterPool(PoolAllocatorBase* pool) {
+	for (unsigned int i = 0; i < m_PoolCount; i++) {
+		if (m_Pools[i] == pool) {
+			m_Pools[i] = m_Pools[--m_PoolCount];
+			return;
+		}
+	}
 }
 
-void Memory::Set(void* block, int value, int size) {
-	memset(block, value, size);
+void Memory::ZeroOut(void* block, unsigned long long size) {
+	Set(block, 0, size);
+}
+
+void Memory::Set(void* block, int value, unsigned long long size) {
+	if (size >= MEMORY_STREAMING_THRESHOLD) {
+		MemoryKernels::StreamFill(block, value, size);
+		return;
+	}
+	memset(block, value, (size_t)size);
 }
 
 void Memory::PrintMemoryStats() {
+	MemoryStats stats = GetStats();
 	for (int i = 0; i < MEMORY_TAG_MAX; i++) {
-		EN_INFO("%s: %u", m_MemoryTagStrings[i], m_Stats.s_MemoryAllocationStats[i]);
+		const MemoryTagStats& tag = stats.s_Tags[i];
+		EN_INFO("%s: %llu bytes, peak %llu bytes, %llu live of %llu allocations, %.0f allocations/s, %.0f bytes/s",
+			m_MemoryTagStrings[i],
+			tag.s_CurrentBytes,
+			tag.s_PeakBytes,
+			tag.s_LiveAllocations,
+			tag.s_TotalAllocations,
+			tag.s_AllocationsPerSecond,
+			tag.s_BytesPerSecond);
+		for (unsigned int j = 0; j < m_PoolCount; j++) {
+			if (m_Pools[j]->GetTag() == i) {
+				EN_INFO("    Pool %s: %u of %u slots in use (%u bytes per slot).",
+					m_Pools[j]->GetName(),
+					m_Pools[j]->GetUsed(),
+					m_Pools[j]->GetCapacity(),
+					m_Pools[j]->GetSlotSize());
+			}
+		}
 	}
-	EN_INFO("Total allocations: %d.", m_Stats.s_TotalAllocations);
+	EN_INFO("Total: %llu bytes, peak %llu bytes, %llu live allocations.",
+		stats.s_CurrentBytes,
+		stats.s_PeakBytes,
+		stats.s_LiveAllocations);
+
+	EN_INFO("Heap address space: %llu bytes reserved, %llu bytes committed (%s pages of %llu bytes).",
+		m_HeapRange.s_Reserved,
+		m_HeapRange.s_Committed,
+		VirtualMemory::GetPageModeString(m_HeapRange.s_PageMode),
+		m_HeapRange.s_PageSize);
+
+	HeapStats heap = m_Heap.GetStats();
+	EN_INFO("Heap: %llu of %llu bytes used in %u blocks, %u free blocks, largest free block %llu bytes, fragmentation %.2f.",
+		heap.s_UsedBytes,
+		heap.s_Capacity,
+		heap.s_UsedBlockCount,
+		heap.s_FreeBlockCount,
+		heap.s_LargestFreeBlock,
+		heap.s_Fragmentation);
+	EN_INFO("Heap fallback allocations: %llu.", stats.s_FallbackAllocations);
+	EN_INFO("Frame allocator: last frame %llu bytes, high-water mark %llu of %llu bytes.",
+		m_LastFrameAllocated,
+		m_FrameAllocator.GetHighWaterMark(),
+		m_FrameAllocator.GetCapacity());
+	EN_INFO("Load stack: %llu persistent and %llu scratch bytes in use, high-water mark %llu of %llu bytes.",
+		m_LoadStack.GetPersistentUsed(),
+		m_LoadStack.GetScratchUsed(),
+		m_LoadStack.GetHighWaterMark(),
+		m_LoadStack.GetCapacity());
 }
 
-void* Memory::Copy(void* dest, const void* src, unsigned int size) {
+void* Memory::Copy(void* dest, const void* src, unsigned long long size) {
+	if (size >= MEMORY_STREAMING_THRESHOLD) {
+		MemoryKernels::StreamCopy(dest, src, size);
+		return dest;
+	}
 	return memcpy(dest, src, (size_t)size);
 }
 
-unsigned int Memory::GetTotalAllocations() {
-	return m_Stats.s_TotalAllocations;
-}
\ No newline at end of file
+void* Memory::CopyToMapped(void* dest, const void* src, unsigned long long size) {
+	if (size >= MEMORY_MAPPED_STREAMING_THRESHOLD) {
+		MemoryKernels::StreamCopy(dest, src, size);
+		return dest;
+	}
+	return memcpy(dest, src, (size_t)size);
+}
+
+unsigned long long Memory::GetTotalAllocations() {
+	return GetStats().s_LiveAllocations;
+}
+
+HeapStats Memory::GetHeapStats() {
+	return m_Heap.GetStats();
+}
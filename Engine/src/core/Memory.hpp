@@ -1,5 +1,24 @@
 #pragma once
 #include <memory.h>
+#include <atomic>
+#include <mutex>
+
+#include "HeapAllocator.hpp"
+#include "VirtualMemory.hpp"
+
+#define MAX_MEMORY_POOLS 32
+// Threads beyond this many live threads share one set of stat counters
+#define MAX_MEMORY_STAT_THREADS 64
+// Copies and fills at least this large bypass the cache with streaming stores
+#define MEMORY_STREAMING_THRESHOLD (8ULL * 1024 * 1024)
+// Writes into mapped GPU memory stream from this size on, the memory is write-combined
+// and never read back, so there is nothing to gain from going through the cache
+#define MEMORY_MAPPED_STREAMING_THRESHOLD (4ULL * 1024)
+// The heap grows in steps of at least this many bytes once the committed part is used up
+#define MEMORY_HEAP_COMMIT_STEP (8ULL * 1024 * 1024)
+
+class PoolAllocatorBase;
+class StackAllocator;
 
 enum MemoryTag {
 	MEMORY_TAG_ARRAY,
@@ -7,26 +26,151 @@ enum MemoryTag {
 	MEMORY_TAG_TEXTURE,
 	MEMORY_TAG_MESH,
 	MEMORY_TAG_RENDERER,
+	MEMORY_TAG_FRAME,
+	MEMORY_TAG_LOAD,
 	MEMORY_TAG_MAX
 };
 
-struct AllocationStats {
-	unsigned int s_MemoryAllocationStats[MEMORY_TAG_MAX];
-	unsigned int s_TotalAllocations = 0;
+// Counters of one thread. Only the owning thread writes to them, so the atomic
+// adds never contend. They are summed up whenever stats are requested.
+struct alignas(64) MemoryThreadStats {
+	std::atomic<long long> s_Bytes[MEMORY_TAG_MAX];
+	std::atomic<long long> s_LiveAllocations[MEMORY_TAG_MAX];
+	std::atomic<unsigned long long> s_AllocatedBytes[MEMORY_TAG_MAX];
+	std::atomic<unsigned long long> s_Allocations[MEMORY_TAG_MAX];
+	// Allocations that did not fit into the engine heap and went to the system heap
+	std::atomic<unsigned long long> s_FallbackAllocations;
+	std::atomic<bool> s_InUse;
+};
+
+struct MemoryTagStats {
+	unsigned long long s_CurrentBytes;
+	// Sampled whenever the stats are merged, at least once per frame
+	unsigned long long s_PeakBytes;
+	unsigned long long s_LiveAllocations;
+	unsigned long long s_TotalAllocations;
+	// Measured between the last two calls to UpdateStats
+	double s_AllocationsPerSecond;
+	double s_BytesPerSecond;
+};
+
+struct MemoryStats {
+	MemoryTagStats s_Tags[MEMORY_TAG_MAX];
+	unsigned long long s_CurrentBytes;
+	unsigned long long s_PeakBytes;
+	unsigned long long s_LiveAllocations;
+	unsigned long long s_FallbackAllocations;
 };
 
+struct MemoryConfig {
+	// Address space reserved up front for the engine heap
+	unsigned long long s_HeapSize;
+	// Part of the heap that is committed right away, the rest is committed as the heap grows
+	unsigned long long s_HeapInitialCommitSize;
+	MemoryPageMode s_HeapPageMode;
+	// Size of the linear allocator that is reset once per frame
+	unsigned long long s_FrameAllocatorSize;
+	// Size of the double-ended stack used by loaders
+	unsigned long long s_LoadStackSize;
+	// Stats are printed every this many frames, 0 never prints them
+	unsigned int s_StatsDumpInterval;
+};
+
+// Bump allocator over one fixed block. Allocations are never freed individually,
+// the whole allocator is rewound with Reset() instead.
+class LinearAllocator {
+public:
+	LinearAllocator() = default;
+	~LinearAllocator();
+
+	bool Create(unsigned long long capacity, MemoryTag tag);
+	void Destroy();
+
+	void* Allocate(unsigned long long size, unsigned long long alignment = 16);
+	// Invalidates every allocation made since the last reset
+	void Reset();
+
+	unsigned long long GetCapacity() const { return m_Capacity; }
+	unsigned long long GetAllocated() const { return m_Offset; }
+	unsigned long long GetHighWaterMark() const { return m_HighWaterMark; }
+private:
+	char* m_Memory = nullptr;
+	unsigned long long m_Capacity = 0;
+	unsigned long long m_Offset = 0;
+	unsigned long long m_HighWaterMark = 0;
+	MemoryTag m_Tag = MEMORY_TAG_MAX;
+};
 
 class Memory {
 public:
-	static void* Allocate(unsigned int size, MemoryTag tag);
-	static void Free(void* block, unsigned int size, MemoryTag tag);
-	static void* Copy(void* dest, const void* src, unsigned int size);
-	static void ZeroOut(void* block, int size);
-	static void Set(void* block, int value, int size);
-	static unsigned int GetTotalAllocations();
+	static bool Initialize(const MemoryConfig& config);
+	static void Shutdown();
+
+	static void* Allocate(unsigned long long size, MemoryTag tag);
+	static void Free(void* block, unsigned long long size, MemoryTag tag);
+	static void* Copy(void* dest, const void* src, unsigned long long size);
+	// For destinations in mapped, write-combined GPU memory like staging buffers
+	static void* CopyToMapped(void* dest, const void* src, unsigned long long size);
+	static void ZeroOut(void* block, unsigned long long size);
+	static void Set(void* block, int value, unsigned long long size);
+
+	// Scratch memory that is only valid until the end of the current frame
+	static void* AllocateFrame(unsigned long long size, unsigned long long alignment = 16);
+	// Called once per frame by the application loop. Also updates the stats
+	// and dumps them if a dump interval is set.
+	static void ResetFrame();
+
+	// Level data on the persistent side, transient loader buffers on the scratch side
+	static StackAllocator& GetLoadStack();
+
+	// Pools register themselves so they show up in the stats and are released on shutdown
+	static void RegisterPool(PoolAllocatorBase* pool);
+	static void UnregisterPool(PoolAllocatorBase* pool);
+
+	// Merges the counters of all threads. Safe to call from any thread.
+	static MemoryStats GetStats();
+	// Merges the counters, updates the peaks and measures the allocation rates since the last call
+	static void UpdateStats();
+	// Prints the stats every frames frames, 0 turns it off
+	static void SetStatsDumpInterval(unsigned int frames) { m_StatsDumpInterval = frames; }
+
+	static unsigned long long GetTotalAllocations();
+	static HeapStats GetHeapStats();
+	static unsigned long long GetReservedBytes() { return m_HeapRange.s_Reserved; }
+	static unsigned long long GetCommittedBytes() { return m_HeapRange.s_Committed; }
 	static void PrintMemoryStats();
+private:
+	static void* allocateGrowing(unsigned long long size);
+
+	static MemoryThreadStats* acquireThreadStats();
+	static void releaseThreadStats(MemoryThreadStats* stats);
+	static MemoryStats mergeStats();
+
+	friend struct MemoryThreadStatsHandle;
 private:
 	static const char* m_MemoryTagStrings[MEMORY_TAG_MAX];
-	static AllocationStats m_Stats;
-	static unsigned long m_Capacity;
-};
\ No newline at end of file
+	static unsigned long long m_Capacity;
+
+	static MemoryThreadStats m_ThreadStats[MAX_MEMORY_STAT_THREADS];
+	// Counters of exited threads and of threads that found no free slot
+	static MemoryThreadStats m_SharedStats;
+	static std::mutex m_StatsMutex;
+	static unsigned long long m_PeakBytes[MEMORY_TAG_MAX];
+	static unsigned long long m_TotalPeakBytes;
+	static MemoryStats m_LastUpdate;
+	static unsigned long long m_LastAllocatedBytes[MEMORY_TAG_MAX];
+	static unsigned long long m_LastUpdateTime;
+	static unsigned int m_StatsDumpInterval;
+	static unsigned long long m_FrameNumber;
+
+	static VirtualRange m_HeapRange;
+	static HeapAllocator m_Heap;
+	static std::mutex m_GrowMutex;
+
+	static LinearAllocator m_FrameAllocator;
+	static unsigned long long m_LastFrameAllocated;
+	static StackAllocator m_LoadStack;
+
+	static PoolAllocatorBase* m_Pools[MAX_MEMORY_POOLS];
+	static unsigned int m_PoolCount;
+};
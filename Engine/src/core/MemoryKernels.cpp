@@ -0,0 +1,187 @@
+#include <string.h>
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+// MSVC allows AVX2 intrinsics in any function
+#define KERNEL_TARGET_AVX2
+#else
+#include <cpuid.h>
+#define KERNEL_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+#include "MemoryKernels.hpp"
+#include "Logger.hpp"
+
+static void genericCopy(void* dest, const void* src, unsigned long long size) {
+	memcpy(dest, src, (size_t)size);
+}
+
+static void genericFill(void* dest, int value, unsigned long long size) {
+	memset(dest, value, (size_t)size);
+}
+
+// Every x64 CPU has SSE2, so this is the baseline streaming kernel
+static void sse2StreamCopy(void* dest, const void* src, unsigned long long size) {
+	char* d = (char*)dest;
+	const char* s = (const char*)src;
+	// Non-temporal stores need an aligned destination, copy the head normally
+	unsigned long long head = (16 - ((unsigned long long)d & 15)) & 15;
+	if (head > size) {
+		head = size;
+	}
+	memcpy(d, s, (size_t)head);
+	d += head;
+	s += head;
+	size -= head;
+
+	unsigned long long blocks = size / 64;
+	for (unsigned long long i = 0; i < blocks; i++) {
+		__m128i a = _mm_loadu_si128((const __m128i*)s);
+		__m128i b = _mm_loadu_si128((const __m128i*)(s + 16));
+		__m128i c = _mm_loadu_si128((const __m128i*)(s + 32));
+		__m128i e = _mm_loadu_si128((const __m128i*)(s + 48));
+		_mm_stream_si128((__m128i*)d, a);
+		_mm_stream_si128((__m128i*)(d + 16), b);
+		_mm_stream_si128((__m128i*)(d + 32), c);
+		_mm_stream_si128((__m128i*)(d + 48), e);
+		d += 64;
+		s += 64;
+	}
+	// Streaming stores are weakly ordered, fence before anyone else may read the data
+	_mm_sfence();
+	memcpy(d, s, (size_t)(size & 63));
+}
+
+static void sse2StreamFill(void* dest, int value, unsigned long long size) {
+	char* d = (char*)dest;
+	unsigned long long head = (16 - ((unsigned long long)d & 15)) & 15;
+	if (head > size) {
+		head = size;
+	}
+	memset(d, value, (size_t)head);
+	d += head;
+	size -= head;
+
+	__m128i v = _mm_set1_epi8((char)value);
+	unsigned long long blocks = size / 64;
+	for (unsigned long long i = 0; i < blocks; i++) {
+		_mm_stream_si128((__m128i*)d, v);
+		_mm_stream_si128((__m128i*)(d + 16), v);
+		_mm_stream_si128((__m128i*)(d + 32), v);
+		_mm_stream_si128((__m128i*)(d + 48), v);
+		d += 64;
+	}
+	_mm_sfence();
+	memset(d, value, (size_t)(size & 63));
+}
+
+KERNEL_TARGET_AVX2
+static void avx2StreamCopy(void* dest, const void* src, unsigned long long size) {
+	char* d = (char*)dest;
+	const char* s = (const char*)src;
+	unsigned long long head = (32 - ((unsigned long long)d & 31)) & 31;
+	if (head > size) {
+		head = size;
+	}
+	memcpy(d, s, (size_t)head);
+	d += head;
+	s += head;
+	size -= head;
+
+	// Two cache lines per iteration keeps enough loads in flight to saturate the write combining buffers
+	unsigned long long blocks = size / 128;
+	for (unsigned long long i = 0; i < blocks; i++) {
+		__m256i a = _mm256_loadu_si256((const __m256i*)s);
+		__m256i b = _mm256_loadu_si256((const __m256i*)(s + 32));
+		__m256i c = _mm256_loadu_si256((const __m256i*)(s + 64));
+		__m256i e = _mm256_loadu_si256((const __m256i*)(s + 96));
+		_mm256_stream_si256((__m256i*)d, a);
+		_mm256_stream_si256((__m256i*)(d + 32), b);
+		_mm256_stream_si256((__m256i*)(d + 64), c);
+		_mm256_stream_si256((__m256i*)(d + 96), e);
+		d += 128;
+		s += 128;
+	}
+	_mm_sfence();
+	memcpy(d, s, (size_t)(size & 127));
+}
+
+KERNEL_TARGET_AVX2
+static void avx2StreamFill(void* dest, int value, unsigned long long size) {
+	char* d = (char*)dest;
+	unsigned long long head = (32 - ((unsigned long long)d & 31)) & 31;
+	if (head > size) {
+		head = size;
+	}
+	memset(d, value, (size_t)head);
+	d += head;
+	size -= head;
+
+	__m256i v = _mm256_set1_epi8((char)value);
+	unsigned long long blocks = size / 128;
+	for (unsigned long long i = 0; i < blocks; i++) {
+		_mm256_stream_si256((__m256i*)d, v);
+		_mm256_stream_si256((__m256i*)(d + 32), v);
+		_mm256_stream_si256((__m256i*)(d + 64), v);
+		_mm256_stream_si256((__m256i*)(d + 96), v);
+		d += 128;
+	}
+	_mm_sfence();
+	memset(d, value, (size_t)(size & 127));
+}
+
+void (*MemoryKernels::m_StreamCopy)(void* dest, const void* src, unsigned long long size) = genericCopy;
+void (*MemoryKernels::m_StreamFill)(void* dest, int value, unsigned long long size) = genericFill;
+const char* MemoryKernels::m_KernelName = "generic";
+
+// AVX2 needs the CPU flag and the OS saving the YMM registers on context switches
+static bool cpuHasAVX2() {
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) {
+		return false;
+	}
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) {
+		return false;
+	}
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	unsigned int a, b, c, d;
+	if (__get_cpuid_max(0, nullptr) < 7) {
+		return false;
+	}
+	__cpuid(1, a, b, c, d);
+	bool osxsave = (c & (1 << 27)) != 0;
+	bool avx = (c & (1 << 28)) != 0;
+	if (!osxsave || !avx) {
+		return false;
+	}
+	unsigned int xcr0Low, xcr0High;
+	__asm__("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+	if ((xcr0Low & 6) != 6) {
+		return false;
+	}
+	__cpuid_count(7, 0, a, b, c, d);
+	return (b & (1 << 5)) != 0;
+#endif
+}
+
+void MemoryKernels::Initialize() {
+	if (cpuHasAVX2()) {
+		m_StreamCopy = avx2StreamCopy;
+		m_StreamFill = avx2StreamFill;
+		m_KernelName = "AVX2";
+	}
+	else {
+		m_StreamCopy = sse2StreamCopy;
+		m_StreamFill = sse2StreamFill;
+		m_KernelName = "SSE2";
+	}
+	EN_DEBUG("Using %s streaming memory kernels.", m_KernelName);
+}
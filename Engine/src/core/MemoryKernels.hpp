@@ -0,0 +1,19 @@
+#pragma once
+
+// Streaming copy and fill with non-temporal stores. They bypass the cache, which pays
+// off for write-combined memory (mapped GPU buffers) and for blocks larger than the
+// last level cache. The best kernel for the CPU is picked at runtime.
+class MemoryKernels {
+public:
+	// Called by Memory::Initialize. Until then the generic kernels are used.
+	static void Initialize();
+	static const char* GetKernelName() { return m_KernelName; }
+
+	// dest and src must not overlap
+	static void StreamCopy(void* dest, const void* src, unsigned long long size) { m_StreamCopy(dest, src, size); }
+	static void StreamFill(void* dest, int value, unsigned long long size) { m_StreamFill(dest, value, size); }
+private:
+	static void (*m_StreamCopy)(void* dest, const void* src, unsigned long long size);
+	static void (*m_StreamFill)(void* dest, int value, unsigned long long size);
+	static const char* m_KernelName;
+};
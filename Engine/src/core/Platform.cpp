@@ -91,6 +91,12 @@ double Platform::getAbsoluteTime() {
 	return (double)counter.QuadPart / m_PerformanceFrequency.QuadPart;
 }
 
+double Platform::getMessageTime() {
+	// GetMessageTime is in milliseconds of the tick count, move it onto the performance counter by its age
+	DWORD age = GetTickCount() - (DWORD)GetMessageTime();
+	return getAbsoluteTime() - age / 1000.0;
+}
+
 void Platform::pSleep(long ms) {
 	if(ms > 0) {
 		Sleep(ms);
@@ -158,13 +164,13 @@ LRESULT CALLBACK Platform::handleWin32Messages(HWND hwnd, UINT uMsg, WPARAM wPar
 			EventContext c = {};
 			c.u32[0] = LOWORD(lParam);
 			c.u32[1] = HIWORD(lParam);
-			EventSystem::FireEvent(nullptr, c, EVENT_TYPE_WINDOW_RESIZE);
+			EventSystem::PostEvent(nullptr, c, EVENT_TYPE_WINDOW_RESIZE);
 			break;
 		}
 		case WM_CLOSE:
 		case WM_DESTROY: {
 			EventContext c = {};
-			EventSystem::FireEvent(nullptr, c, EVENT_TYPE_WINDOW_CLOSE);
+			EventSystem::PostEvent(nullptr, c, EVENT_TYPE_WINDOW_CLOSE);
 			PostQuitMessage(0);
 			return 0;
 		}
@@ -173,14 +179,12 @@ LRESULT CALLBACK Platform::handleWin32Messages(HWND hwnd, UINT uMsg, WPARAM wPar
 			EventContext c = {};
 			c.u32[0] = (int)(short)LOWORD(lParam);   // horizontal position 
 			c.u32[1] = (int)(short)HIWORD(lParam);
-			EventSystem::FireEvent(nullptr, c, EVENT_TYPE_WINDOW_MOVED);
+			EventSystem::PostEvent(nullptr, c, EVENT_TYPE_WINDOW_MOVED);
 			return 0;
 		}
 		case WM_MOUSEMOVE: {
-			EventContext c = {};
-			c.u32[0] = GET_X_LPARAM(lParam);
-			c.u32[1] = GET_Y_LPARAM(lParam);
-			EventSystem::FireEvent(nullptr, c, EVENT_TYPE_MOUSE_MOVED);
+			Input::ProcessMouseMove(GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam), getMessageTime());
+			break;
 		}
 		case WM_LBUTTONDOWN:
 		case WM_RBUTTONDOWN:
@@ -193,39 +197,34 @@ LRESULT CALLBACK Platform::handleWin32Messages(HWND hwnd, UINT uMsg, WPARAM wPar
 			switch (uMsg) {
 				case WM_LBUTTONDOWN:
 				case WM_LBUTTONUP: {
-					Input::ProcessMouseInput(MOUSE_CODE_LEFT, pressed);
+					Input::ProcessMouseInput(MOUSE_CODE_LEFT, pressed, getMessageTime());
 					break;
 				}
 				case WM_RBUTTONDOWN:
 				case WM_RBUTTONUP: {
-					Input::ProcessMouseInput(MOUSE_CODE_RIGHT, pressed);
+					Input::ProcessMouseInput(MOUSE_CODE_RIGHT, pressed, getMessageTime());
 					break;
 				}
 				case WM_MBUTTONDOWN:
 				case WM_MBUTTONUP: {
-					Input::ProcessMouseInput(MOUSE_CODE_MIDDLE, pressed);
+					Input::ProcessMouseInput(MOUSE_CODE_MIDDLE, pressed, getMessageTime());
 					break;
 				}
 
 			}
+			break;
 		}
 		case WM_KEYDOWN:
 		case WM_KEYUP:
 		case WM_SYSKEYDOWN:
 		case WM_SYSKEYUP: {
-			EventContext c{};
-			c.u32[0] = (int)wParam;
-
 			// TODO handle alt, shift... keys as well
 			bool pressed = uMsg == WM_KEYDOWN || uMsg == WM_SYSKEYDOWN;
-			Input::ProcessKeyInput((KeyCode)wParam, pressed);
+			Input::ProcessKeyInput((KeyCode)wParam, pressed, getMessageTime());
+			break;
 		}
 		case WM_MOUSEWHEEL: {
-			EventContext c;
-			c.u32[0] = GET_WHEEL_DELTA_WPARAM(wParam);
-			c.u32[1] = GET_X_LPARAM(lParam);
-			c.u32[2] = GET_Y_LPARAM(lParam);
-			EventSystem::FireEvent(nullptr, c, EVENT_TYPE_MOUSE_SCROLLED);
+			Input::ProcessMouseWheel(GET_WHEEL_DELTA_WPARAM(wParam), GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam), getMessageTime());
 			break;
 		}
 	}
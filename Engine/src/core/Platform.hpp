@@ -24,6 +24,8 @@ public:
 private:
 	bool create(const char* name, unsigned int width, unsigned int height);
 	void destroy();
+	// getAbsoluteTime of the message being handled, when it was posted rather than when it was pumped
+	static double getMessageTime();
 public:
 	static HWND m_Handle;
 	static HINSTANCE m_hInstance;
@@ -0,0 +1,161 @@
+#include <intrin.h>
+
+#include "PoolAllocator.hpp"
+#include "Logger.hpp"
+
+// Every chunk starts with a link to the next chunk, the slots follow on the next cache line
+struct PoolChunkHeader {
+	void* s_Next;
+};
+
+PoolAllocatorBase* PoolAllocatorBase::m_LivePools;
+std::atomic_flag PoolAllocatorBase::m_LivePoolsLock = ATOMIC_FLAG_INIT;
+std::atomic<unsigned long long> PoolAllocatorBase::m_NextGeneration;
+
+static void lockLivePools(std::atomic_flag& flag) {
+	while (flag.test_and_set(std::memory_order_acquire)) {
+		_mm_pause();
+	}
+}
+
+PoolAllocatorBase::PoolAllocatorBase(const char* name, unsigned int slotSize, unsigned int slotsPerChunk, MemoryTag tag)
+	: m_Name(name), m_Tag(tag), m_SlotsPerChunk(slotsPerChunk) {
+	// Round slots up to whole cache lines so neighbouring objects never share one
+	if (slotSize < sizeof(void*)) {
+		slotSize = sizeof(void*);
+	}
+	m_SlotSize = (slotSize + POOL_CACHE_LINE_SIZE - 1) & ~(POOL_CACHE_LINE_SIZE - 1);
+	// Generations are unique across pools, a new pool at the address of a dead one does not match its caches
+	m_Generation.store(m_NextGeneration.fetch_add(1, std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+	lockLivePools(m_LivePoolsLock);
+	m_NextLive = m_LivePools;
+	m_LivePools = this;
+	m_LivePoolsLock.clear(std::memory_order_release);
+	Memory::RegisterPool(this);
+}
+
+PoolAllocatorBase::~PoolAllocatorBase() {
+	Release();
+
+	// Caches flushed from here on drop their slots instead of touching this pool
+	lockLivePools(m_LivePoolsLock);
+	PoolAllocatorBase** link = &m_LivePools;
+	while (*link && *link != this) {
+		link = &(*link)->m_NextLive;
+	}
+	if (*link) {
+		*link = m_NextLive;
+	}
+	m_LivePoolsLock.clear(std::memory_order_release);
+	Memory::UnregisterPool(this);
+}
+
+void* PoolAllocatorBase::AllocateSlot() {
+	lock();
+	if (!m_FreeList && !grow()) {
+		unlock();
+		EN_ERROR("Pool '%s' could not grow.", m_Name);
+		return nullptr;
+	}
+	void* slot = m_FreeList;
+	m_FreeList = *(void**)slot;
+	m_Used++;
+	unlock();
+	return slot;
+}
+
+void PoolAllocatorBase::FreeSlot(void* slot) {
+	if (!slot) {
+		return;
+	}
+	lock();
+	*(void**)slot = m_FreeList;
+	m_FreeList = slot;
+	m_Used--;
+	unlock();
+}
+
+void PoolAllocatorBase::Release() {
+	// Slots the calling thread still caches are not in use, only other threads' caches are out of reach
+	if (m_FlushThreadCache) {
+		m_FlushThreadCache(this);
+	}
+	lock();
+	if (m_Used > 0) {
+		EN_WARN("Pool '%s' released with %u slots still in use.", m_Name, m_Used);
+	}
+	void* chunk = m_Chunks;
+	while (chunk) {
+		void* next = ((PoolChunkHeader*)chunk)->s_Next;
+		Memory::Free(chunk, chunkSize(), m_Tag);
+		chunk = next;
+	}
+	m_Chunks = nullptr;
+	m_FreeList = nullptr;
+	m_Capacity = 0;
+	m_Used = 0;
+	m_Generation.store(m_NextGeneration.fetch_add(1, std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	unlock();
+}
+
+void PoolAllocatorBase::FlushCache(PoolThreadCache& cache) {
+	if (cache.s_Owner && cache.s_Count > 0) {
+		lockLivePools(m_LivePoolsLock);
+		PoolAllocatorBase* pool = m_LivePools;
+		while (pool && pool != cache.s_Owner) {
+			pool = pool->m_NextLive;
+		}
+		if (pool) {
+			pool->lock();
+			// A released pool has a new generation and no longer owns the memory of the slots
+			if (pool->m_Generation.load(std::memory_order_relaxed) == cache.s_Generation) {
+				for (unsigned int i = 0; i < cache.s_Count; i++) {
+					*(void**)cache.s_Slots[i] = pool->m_FreeList;
+					pool->m_FreeList = cache.s_Slots[i];
+				}
+				pool->m_Used -= cache.s_Count;
+			}
+			pool->unlock();
+		}
+		m_LivePoolsLock.clear(std::memory_order_release);
+	}
+	cache.s_Owner = nullptr;
+	cache.s_Count = 0;
+}
+
+bool PoolAllocatorBase::grow() {
+	char* chunk = (char*)Memory::Allocate(chunkSize(), m_Tag);
+	if (!chunk) {
+		return false;
+	}
+	((PoolChunkHeader*)chunk)->s_Next = m_Chunks;
+	m_Chunks = chunk;
+
+	unsigned long long first = ((unsigned long long)chunk + sizeof(PoolChunkHeader) + POOL_CACHE_LINE_SIZE - 1) & ~(unsigned long long)(POOL_CACHE_LINE_SIZE - 1);
+	char* slots = (char*)first;
+
+	// Thread the new slots onto the free list, lowest address first
+	for (unsigned int i = m_SlotsPerChunk; i > 0; i--) {
+		void* slot = slots + (unsigned long long)(i - 1) * m_SlotSize;
+		*(void**)slot = m_FreeList;
+		m_FreeList = slot;
+	}
+	m_Capacity += m_SlotsPerChunk;
+	return true;
+}
+
+unsigned long long PoolAllocatorBase::chunkSize() const {
+	// Header plus worst case padding to reach the first cache line aligned slot
+	return sizeof(PoolChunkHeader) + POOL_CACHE_LINE_SIZE - 1 + (unsigned long long)m_SlotSize * m_SlotsPerChunk;
+}
+
+void PoolAllocatorBase::lock() {
+	while (m_Lock.test_and_set(std::memory_order_acquire)) {
+		_mm_pause();
+	}
+}
+
+void PoolAllocatorBase::unlock() {
+	m_Lock.clear(std::memory_order_release);
+}
@@ -0,0 +1,153 @@
+#pragma once
+#include <atomic>
+#include <new>
+
+#include "Memory.hpp"
+#include "Logger.hpp"
+
+#define POOL_CACHE_LINE_SIZE 64
+#define POOL_THREAD_CACHE_SIZE 16
+
+struct PoolThreadCache;
+
+// Hands out fixed-size, cache line aligned slots from chunks that are allocated through
+// Memory. Free slots are linked through their own storage, so allocate and free are a
+// pointer swap. Chunks are only returned to Memory on Release().
+class PoolAllocatorBase {
+public:
+	PoolAllocatorBase(const char* name, unsigned int slotSize, unsigned int slotsPerChunk, MemoryTag tag);
+	~PoolAllocatorBase();
+	PoolAllocatorBase(const PoolAllocatorBase&) = delete;
+	PoolAllocatorBase& operator=(const PoolAllocatorBase&) = delete;
+
+	void* AllocateSlot();
+	void FreeSlot(void* slot);
+
+	// Gives every chunk back to Memory. Any slot still in use becomes invalid, and so
+	// do the slots other threads hold in their caches.
+	void Release();
+
+	// Hands cached slots back to their owner, or drops them if the owner was released or destroyed
+	static void FlushCache(PoolThreadCache& cache);
+
+	const char* GetName() const { return m_Name; }
+	MemoryTag GetTag() const { return m_Tag; }
+	unsigned int GetSlotSize() const { return m_SlotSize; }
+	unsigned int GetCapacity() const { return m_Capacity; }
+	unsigned int GetUsed() const { return m_Used; }
+	// Changes on Release, so slots cached before it are never handed out again
+	unsigned long long GetGeneration() const { return m_Generation.load(std::memory_order_relaxed); }
+protected:
+	// Flushes the cache of the calling thread before Release, set by pools with a thread cache
+	void (*m_FlushThreadCache)(PoolAllocatorBase* pool) = nullptr;
+private:
+	bool grow();
+	unsigned long long chunkSize() const;
+
+	void lock();
+	void unlock();
+private:
+	const char* m_Name;
+	MemoryTag m_Tag;
+	unsigned int m_SlotSize;
+	unsigned int m_SlotsPerChunk;
+
+	void* m_FreeList = nullptr;
+	void* m_Chunks = nullptr;
+	unsigned int m_Capacity = 0;
+	unsigned int m_Used = 0;
+
+	std::atomic_flag m_Lock = ATOMIC_FLAG_INIT;
+	std::atomic<unsigned long long> m_Generation;
+
+	// Pools that are alive, a cache only touches its owner if it is still in here
+	PoolAllocatorBase* m_NextLive = nullptr;
+	static PoolAllocatorBase* m_LivePools;
+	static std::atomic_flag m_LivePoolsLock;
+	static std::atomic<unsigned long long> m_NextGeneration;
+};
+
+// Per thread stash of free slots so threads that churn objects of one type
+// do not contend on the pool lock. Cached slots still count as used in the pool stats
+// until the cache is flushed, which happens at the latest when the thread exits.
+struct PoolThreadCache {
+	PoolAllocatorBase* s_Owner = nullptr;
+	// Generation of the owner when the slots were cached
+	unsigned long long s_Generation = 0;
+	void* s_Slots[POOL_THREAD_CACHE_SIZE];
+	unsigned int s_Count = 0;
+
+	~PoolThreadCache() { PoolAllocatorBase::FlushCache(*this); }
+};
+
+template<typename T, bool ThreadCache = false, unsigned int SlotsPerChunk = 32>
+class PoolAllocator : public PoolAllocatorBase {
+public:
+	// The same rounding the base applies, known here at compile time
+	static constexpr unsigned int SlotSize = (unsigned int)(((sizeof(T) < sizeof(void*) ? sizeof(void*) : sizeof(T)) + POOL_CACHE_LINE_SIZE - 1) & ~(size_t)(POOL_CACHE_LINE_SIZE - 1));
+	static_assert(sizeof(T) <= SlotSize, "PoolAllocator slots have to hold a whole T.");
+	static_assert(alignof(T) <= POOL_CACHE_LINE_SIZE, "PoolAllocator slots are only cache line aligned.");
+
+	PoolAllocator(const char* name, MemoryTag tag)
+		: PoolAllocatorBase(name, SlotSize, SlotsPerChunk, tag) {
+		if constexpr (ThreadCache) {
+			m_FlushThreadCache = flushThreadCache;
+		}
+	}
+
+	void* Allocate() {
+		if constexpr (ThreadCache) {
+			PoolThreadCache& cache = m_ThreadCache;
+			if (cache.s_Owner == this && cache.s_Count > 0) {
+				if (cache.s_Generation == GetGeneration()) {
+					return cache.s_Slots[--cache.s_Count];
+				}
+				// The pool was released since, the cached slots point into freed chunks
+				cache.s_Count = 0;
+			}
+		}
+		return AllocateSlot();
+	}
+
+	// For class operator new, which must not return null. A derived class that is larger
+	// than T would overrun the slot, so it is refused as well.
+	void* AllocateObject(size_t size) {
+		if (size > sizeof(T)) {
+			EN_FATAL("Pool '%s' was asked for an object of %llu bytes, its slots are made for %llu.", GetName(), (unsigned long long)size, (unsigned long long)sizeof(T));
+			throw std::bad_alloc();
+		}
+		void* slot = Allocate();
+		if (!slot) {
+			throw std::bad_alloc();
+		}
+		return slot;
+	}
+
+	void Free(void* slot) {
+		if constexpr (ThreadCache) {
+			PoolThreadCache& cache = m_ThreadCache;
+			if (cache.s_Owner != this || cache.s_Generation != GetGeneration()) {
+				// The cache belonged to another pool of the same type or to an earlier generation of this one
+				FlushCache(cache);
+				cache.s_Owner = this;
+				cache.s_Generation = GetGeneration();
+			}
+			if (cache.s_Count < POOL_THREAD_CACHE_SIZE) {
+				cache.s_Slots[cache.s_Count++] = slot;
+				return;
+			}
+		}
+		FreeSlot(slot);
+	}
+private:
+	static void flushThreadCache(PoolAllocatorBase* pool) {
+		if (m_ThreadCache.s_Owner == pool) {
+			FlushCache(m_ThreadCache);
+		}
+	}
+
+	static thread_local PoolThreadCache m_ThreadCache;
+};
+
+template<typename T, bool ThreadCache, unsigned int SlotsPerChunk>
+thread_local PoolThreadCache PoolAllocator<T, ThreadCache, SlotsPerChunk>::m_ThreadCache;
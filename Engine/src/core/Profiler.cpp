@@ -0,0 +1,401 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#define PROFILER_HAS_TSC 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#include <cpuid.h>
+#endif
+#else
+#define PROFILER_HAS_TSC 0
+#endif
+
+#include "Profiler.hpp"
+#include "File.hpp"
+#include "Logger.hpp"
+
+static_assert((PROFILER_THREAD_CAPACITY & (PROFILER_THREAD_CAPACITY - 1)) == 0, "PROFILER_THREAD_CAPACITY has to be a power of two");
+static_assert((PROFILER_MAX_ZONES & (PROFILER_MAX_ZONES - 1)) == 0, "PROFILER_MAX_ZONES has to be a power of two");
+
+bool Profiler::m_Initialized;
+double Profiler::m_TicksPerSecond = 1e9;
+unsigned long long Profiler::m_BaseTicks;
+const char* Profiler::m_TracePath;
+ProfileThread Profiler::m_Threads[PROFILER_MAX_THREADS];
+ProfileZoneStats Profiler::m_Stats[PROFILER_MAX_ZONES];
+unsigned int Profiler::m_StatsCount;
+unsigned long long Profiler::m_FrameNumber;
+bool Profiler::m_FrameOpen;
+
+// Threads keep their ring after they exit, the trace still needs it
+struct ProfileThreadHandle {
+	ProfileThread* s_Thread = nullptr;
+	bool s_Acquired = false;
+};
+
+static thread_local ProfileThreadHandle threadHandle;
+
+static unsigned long long nowNanoseconds() {
+	return (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// The counter only measures time if its rate does not follow the clock speed of the core
+static bool hasInvariantTsc() {
+#if PROFILER_HAS_TSC
+#ifdef _MSC_VER
+	int registers[4];
+	__cpuid(registers, 0x80000000);
+	if ((unsigned int)registers[0] < 0x80000007) {
+		return false;
+	}
+	__cpuid(registers, 0x80000007);
+	return (registers[3] & (1 << 8)) != 0;
+#else
+	unsigned int eax, ebx, ecx, edx;
+	if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) {
+		return false;
+	}
+	return (edx & (1 << 8)) != 0;
+#endif
+#else
+	return false;
+#endif
+}
+
+// A zone in the ring can be overwritten while it is read, it is only valid if the
+// writer did not get to its slot again before the copy was done
+static bool readZone(const ProfileThread& thread, unsigned long long index, ProfileZone& zone) {
+	zone = thread.s_Zones[index & (PROFILER_THREAD_CAPACITY - 1)];
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return thread.s_Head.load(std::memory_order_relaxed) < index + PROFILER_THREAD_CAPACITY;
+}
+
+// Zone names end up in a JSON string
+static void escapeName(char* buffer, unsigned int size, const char* name) {
+	unsigned int length = 0;
+	for (const char* c = name; *c && length + 3 < size; c++) {
+		if (*c == '"' || *c == '\\') {
+			buffer[length++] = '\\';
+			buffer[length++] = *c;
+		}
+		else if ((unsigned char)*c >= 0x20) {
+			buffer[length++] = *c;
+		}
+	}
+	buffer[length] = '\0';
+}
+
+bool Profiler::Initialize(const char* tracePath) {
+	if (m_Initialized) {
+		EN_WARN("Profiler::Initialize was called twice.");
+		return false;
+	}
+#if PROFILER_HAS_TSC
+	if (!hasInvariantTsc()) {
+		EN_WARN("The time stamp counter of this CPU is not invariant, profiler times can be off.");
+	}
+	// Count time stamp ticks against the steady clock for a short while
+	unsigned long long startNanoseconds = nowNanoseconds();
+	unsigned long long startTicks = __rdtsc();
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	unsigned long long endNanoseconds = nowNanoseconds();
+	unsigned long long endTicks = __rdtsc();
+	m_TicksPerSecond = (double)(endTicks - startTicks) * 1e9 / (double)(endNanoseconds - startNanoseconds);
+#else
+	m_TicksPerSecond = 1e9;
+#endif
+	m_BaseTicks = GetTicks();
+	m_TracePath = tracePath;
+	m_FrameNumber = 0;
+	m_FrameOpen = false;
+	m_Initialized = true;
+	SetThreadName("Main");
+	EN_INFO("Profiler clock runs at %.3f MHz.", m_TicksPerSecond / 1e6);
+	return true;
+}
+
+void Profiler::Shutdown() {
+	if (!m_Initialized) {
+		return;
+	}
+	if (m_FrameOpen) {
+		EndZone();
+		m_FrameOpen = false;
+	}
+	if (m_TracePath) {
+		WriteChromeTrace(m_TracePath);
+	}
+	for (unsigned int i = 0; i < PROFILER_MAX_THREADS; i++) {
+		if (m_Threads[i].s_InUse.load(std::memory_order_acquire) && m_Threads[i].s_Dropped > 0) {
+			EN_WARN("Profiler dropped %llu zones on thread '%s' that were nested too deep.", m_Threads[i].s_Dropped, m_Threads[i].s_Name);
+		}
+	}
+	m_Initialized = false;
+}
+
+void Profiler::NewFrame() {
+	if (!m_Initialized) {
+		return;
+	}
+	if (m_FrameOpen) {
+		ProfileThread* thread = getThread();
+		if (thread && thread->s_Depth != 1) {
+			EN_WARN("Profiler::NewFrame was called with %u zones open.", thread->s_Depth);
+		}
+		EndZone();
+		foldZones();
+		m_FrameNumber++;
+	}
+	BeginZone(PROFILER_FRAME_ZONE);
+	m_FrameOpen = true;
+}
+
+unsigned long long Profiler::GetTicks() {
+#if PROFILER_HAS_TSC
+	return __rdtsc();
+#else
+	return nowNanoseconds();
+#endif
+}
+
+void Profiler::BeginZone(const char* name) {
+	if (!m_Initialized) {
+		return;
+	}
+	ProfileThread* thread = getThread();
+	if (!thread) {
+		return;
+	}
+	if (thread->s_Depth < PROFILER_MAX_DEPTH) {
+		thread->s_Open[thread->s_Depth].s_Name = name;
+		thread->s_Open[thread->s_Depth].s_Start = GetTicks();
+	}
+	thread->s_Depth++;
+}
+
+void Profiler::EndZone() {
+	unsigned long long end = GetTicks();
+	ProfileThread* thread = threadHandle.s_Thread;
+	if (!thread || thread->s_Depth == 0) {
+		return;
+	}
+	thread->s_Depth--;
+	if (thread->s_Depth >= PROFILER_MAX_DEPTH) {
+		thread->s_Dropped++;
+		return;
+	}
+	unsigned long long head = thread->s_Head.load(std::memory_order_relaxed);
+	ProfileZone& zone = thread->s_Zones[head & (PROFILER_THREAD_CAPACITY - 1)];
+	zone.s_Name = thread->s_Open[thread->s_Depth].s_Name;
+	zone.s_Start = thread->s_Open[thread->s_Depth].s_Start;
+	zone.s_End = end;
+	zone.s_Depth = thread->s_Depth;
+	thread->s_Head.store(head + 1, std::memory_order_release);
+}
+
+void Profiler::SetThreadName(const char* name) {
+	ProfileThread* thread = getThread();
+	if (thread) {
+		snprintf(thread->s_Name, sizeof(thread->s_Name), "%s", name);
+	}
+}
+
+double Profiler::GetAverageFrameTime() {
+	return GetAverageZoneTime(PROFILER_FRAME_ZONE);
+}
+
+double Profiler::GetAverageZoneTime(const char* name) {
+	unsigned long long frames = std::min<unsigned long long>(m_FrameNumber, PROFILER_AVERAGE_FRAMES);
+	if (frames == 0) {
+		return 0.0;
+	}
+	for (unsigned int i = 0; i < PROFILER_MAX_ZONES; i++) {
+		if (m_Stats[i].s_Name && (m_Stats[i].s_Name == name || strcmp(m_Stats[i].s_Name, name) == 0)) {
+			return TicksToMilliseconds(m_Stats[i].s_TickSum) / frames;
+		}
+	}
+	return 0.0;
+}
+
+void Profiler::PrintStats() {
+	unsigned long long frames = std::min<unsigned long long>(m_FrameNumber, PROFILER_AVERAGE_FRAMES);
+	if (frames == 0) {
+		return;
+	}
+	// Zones that started first come first, so children follow their parent
+	unsigned int order[PROFILER_MAX_ZONES];
+	unsigned int count = 0;
+	for (unsigned int i = 0; i < PROFILER_MAX_ZONES; i++) {
+		if (m_Stats[i].s_Name) {
+			order[count++] = i;
+		}
+	}
+	std::sort(order, order + count, [](unsigned int a, unsigned int b) {
+		return m_Stats[a].s_FirstStart < m_Stats[b].s_FirstStart;
+	});
+
+	double frameTime = GetAverageFrameTime();
+	EN_DEBUG("Frame time: %.3f ms (%.1f frames per second) over the last %llu frames",
+		frameTime, frameTime > 0.0 ? 1000.0 / frameTime : 0.0, frames);
+	for (unsigned int i = 0; i < count; i++) {
+		const ProfileZoneStats& stats = m_Stats[order[i]];
+		if (strcmp(stats.s_Name, PROFILER_FRAME_ZONE) == 0) {
+			continue;
+		}
+		unsigned long long maxTicks = 0;
+		for (unsigned long long frame = 0; frame < frames; frame++) {
+			maxTicks = std::max(maxTicks, stats.s_TickHistory[frame]);
+		}
+		EN_DEBUG("%*s%s: %.3f ms, max %.3f ms, %.1f calls per frame",
+			(int)stats.s_Depth * 2, "", stats.s_Name,
+			TicksToMilliseconds(stats.s_TickSum) / frames,
+			TicksToMilliseconds(maxTicks),
+			(double)stats.s_CallSum / frames);
+	}
+}
+
+bool Profiler::WriteChromeTrace(const char* path) {
+	File file;
+	if (!file.Open(path, FILE_MODE_WRITE, true)) {
+		EN_ERROR("Cannot open profiler trace '%s'.", path);
+		return false;
+	}
+	double ticksPerMicrosecond = m_TicksPerSecond / 1e6;
+	char line[512];
+	char name[256];
+	bool first = true;
+	unsigned long long written = 0;
+	int length = snprintf(line, sizeof(line), "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	bool ok = file.Write(line, length);
+
+	for (unsigned int i = 0; i < PROFILER_MAX_THREADS && ok; i++) {
+		const ProfileThread& thread = m_Threads[i];
+		if (!thread.s_InUse.load(std::memory_order_acquire)) {
+			continue;
+		}
+		escapeName(name, sizeof(name), thread.s_Name);
+		length = snprintf(line, sizeof(line), "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+			first ? "" : ",\n", i, name);
+		ok = file.Write(line, length);
+		first = false;
+
+		unsigned long long head = thread.s_Head.load(std::memory_order_acquire);
+		unsigned long long from = head > PROFILER_THREAD_CAPACITY ? head - PROFILER_THREAD_CAPACITY : 0;
+		for (unsigned long long index = from; index < head && ok; index++) {
+			ProfileZone zone;
+			if (!readZone(thread, index, zone) || zone.s_Start < m_BaseTicks) {
+				continue;
+			}
+			escapeName(name, sizeof(name), zone.s_Name);
+			// Complete events, the viewer nests them by time
+			length = snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+				name, i,
+				(zone.s_Start - m_BaseTicks) / ticksPerMicrosecond,
+				(zone.s_End - zone.s_Start) / ticksPerMicrosecond);
+			ok = file.Write(line, length);
+			written++;
+		}
+	}
+	if (ok) {
+		ok = file.Write("\n]}\n", 4);
+	}
+	file.Close();
+	if (!ok) {
+		EN_ERROR("Cannot write profiler trace '%s'.", path);
+		return false;
+	}
+	EN_INFO("Wrote %llu profiler zones to '%s'.", written, path);
+	return true;
+}
+
+ProfileThread* Profiler::getThread() {
+	if (!threadHandle.s_Acquired) {
+		threadHandle.s_Thread = acquireThread();
+		threadHandle.s_Acquired = true;
+	}
+	return threadHandle.s_Thread;
+}
+
+ProfileThread* Profiler::acquireThread() {
+	for (unsigned int i = 0; i < PROFILER_MAX_THREADS; i++) {
+		bool expected = false;
+		if (!m_Threads[i].s_InUse.load(std::memory_order_relaxed)
+			&& m_Threads[i].s_InUse.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+			snprintf(m_Threads[i].s_Name, sizeof(m_Threads[i].s_Name), "Thread %u", i);
+			return &m_Threads[i];
+		}
+	}
+	EN_WARN("Profiler has no ring left for another thread, its zones are not recorded.");
+	return nullptr;
+}
+
+ProfileZoneStats* Profiler::findStats(const char* name, unsigned int depth, unsigned long long start) {
+	// Open addressing on the name pointer, every zone site passes the same one
+	unsigned int slot = (unsigned int)(((unsigned long long)(uintptr_t)name * 0x9E3779B97F4A7C15ULL) >> 32) & (PROFILER_MAX_ZONES - 1);
+	for (unsigned int probe = 0; probe < PROFILER_MAX_ZONES; probe++) {
+		ProfileZoneStats& stats = m_Stats[(slot + probe) & (PROFILER_MAX_ZONES - 1)];
+		if (stats.s_Name == name) {
+			return &stats;
+		}
+		if (!stats.s_Name) {
+			if (m_StatsCount + 1 >= PROFILER_MAX_ZONES) {
+				return nullptr;
+			}
+			m_StatsCount++;
+			stats.s_Name = name;
+			stats.s_Depth = depth;
+			stats.s_FirstStart = start;
+			return &stats;
+		}
+	}
+	return nullptr;
+}
+
+void Profiler::foldZones() {
+	for (unsigned int i = 0; i < PROFILER_MAX_THREADS; i++) {
+		ProfileThread& thread = m_Threads[i];
+		if (!thread.s_InUse.load(std::memory_order_acquire)) {
+			continue;
+		}
+		unsigned long long head = thread.s_Head.load(std::memory_order_acquire);
+		unsigned long long from = thread.s_Scanned;
+		if (head - from > PROFILER_THREAD_CAPACITY) {
+			from = head - PROFILER_THREAD_CAPACITY;
+		}
+		for (unsigned long long index = from; index < head; index++) {
+			ProfileZone zone;
+			if (!readZone(thread, index, zone)) {
+				continue;
+			}
+			ProfileZoneStats* stats = findStats(zone.s_Name, zone.s_Depth, zone.s_Start);
+			if (stats) {
+				stats->s_FrameTicks += zone.s_End - zone.s_Start;
+				stats->s_FrameCalls++;
+			}
+		}
+		thread.s_Scanned = head;
+	}
+
+	// Zones that did not run this frame count as zero
+	unsigned int slot = (unsigned int)(m_FrameNumber % PROFILER_AVERAGE_FRAMES);
+	for (unsigned int i = 0; i < PROFILER_MAX_ZONES; i++) {
+		ProfileZoneStats& stats = m_Stats[i];
+		if (!stats.s_Name) {
+			continue;
+		}
+		stats.s_TickSum += stats.s_FrameTicks - stats.s_TickHistory[slot];
+		stats.s_CallSum = stats.s_CallSum + stats.s_FrameCalls - stats.s_CallHistory[slot];
+		stats.s_TickHistory[slot] = stats.s_FrameTicks;
+		stats.s_CallHistory[slot] = stats.s_FrameCalls;
+		stats.s_FrameTicks = 0;
+		stats.s_FrameCalls = 0;
+	}
+}
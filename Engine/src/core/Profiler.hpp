@@ -0,0 +1,126 @@
+#pragma once
+#include <atomic>
+
+// Zones are compiled in unless EN_PROFILE is defined to 0
+#ifndef EN_PROFILE
+#define EN_PROFILE 1
+#endif
+
+// Threads beyond this many do not record zones
+#define PROFILER_MAX_THREADS 16
+// Completed zones kept per thread, has to be a power of two. The oldest are overwritten.
+#define PROFILER_THREAD_CAPACITY 16384
+// Zones nested deeper than this are counted as dropped
+#define PROFILER_MAX_DEPTH 32
+// Distinct zone names the stats track
+#define PROFILER_MAX_ZONES 256
+// Frames the rolling averages run over
+#define PROFILER_AVERAGE_FRAMES 120
+#define PROFILER_FRAME_ZONE "Frame"
+
+// One completed zone, in ticks of Profiler::GetTicks
+struct ProfileZone {
+	const char* s_Name;
+	unsigned long long s_Start;
+	unsigned long long s_End;
+	unsigned int s_Depth;
+};
+
+struct ProfileOpenZone {
+	const char* s_Name;
+	unsigned long long s_Start;
+};
+
+// Zones of one thread. Only the owning thread writes, the frame thread reads everything
+// below s_Head, which is published after the zone is written.
+struct alignas(64) ProfileThread {
+	ProfileZone s_Zones[PROFILER_THREAD_CAPACITY];
+	std::atomic<unsigned long long> s_Head;
+	ProfileOpenZone s_Open[PROFILER_MAX_DEPTH];
+	unsigned int s_Depth;
+	unsigned long long s_Dropped;
+	// Read up to here by the stats of the frame thread
+	unsigned long long s_Scanned;
+	char s_Name[32];
+	std::atomic<bool> s_InUse;
+};
+
+// Rolling per frame totals of all zones with one name
+struct ProfileZoneStats {
+	const char* s_Name;
+	unsigned int s_Depth;
+	// Start of the first zone seen, orders the printed stats
+	unsigned long long s_FirstStart;
+	unsigned long long s_FrameTicks;
+	unsigned int s_FrameCalls;
+	unsigned long long s_TickHistory[PROFILER_AVERAGE_FRAMES];
+	unsigned int s_CallHistory[PROFILER_AVERAGE_FRAMES];
+	unsigned long long s_TickSum;
+	unsigned long long s_CallSum;
+};
+
+// Hierarchical CPU profiler. Scoped zones are timed with the time stamp counter and
+// written into a ring per thread. Once per frame the zones of all threads are folded
+// into rolling averages, and the rings can be written out as a Chrome trace that
+// chrome://tracing and Perfetto open.
+class Profiler {
+public:
+	// Calibrates the clock and makes the calling thread the frame thread. If tracePath is
+	// set, Shutdown writes the zones still in the rings to it.
+	static bool Initialize(const char* tracePath = nullptr);
+	static void Shutdown();
+
+	// Ends the current frame zone and starts the next one. Only called by the frame thread,
+	// outside of any zone.
+	static void NewFrame();
+
+	static void BeginZone(const char* name);
+	static void EndZone();
+	// Shows up as the thread name in the trace
+	static void SetThreadName(const char* name);
+
+	static unsigned long long GetTicks();
+	static double TicksToMilliseconds(unsigned long long ticks) { return ticks * 1000.0 / m_TicksPerSecond; }
+	// Average of the last frames, in milliseconds
+	static double GetAverageFrameTime();
+	static double GetAverageZoneTime(const char* name);
+
+	// Logs the average time and calls per frame of every zone, nested zones are indented
+	static void PrintStats();
+	static bool WriteChromeTrace(const char* path);
+private:
+	static ProfileThread* getThread();
+	static ProfileThread* acquireThread();
+	static ProfileZoneStats* findStats(const char* name, unsigned int depth, unsigned long long start);
+	static void foldZones();
+
+	static bool m_Initialized;
+	static double m_TicksPerSecond;
+	static unsigned long long m_BaseTicks;
+	static const char* m_TracePath;
+	static ProfileThread m_Threads[PROFILER_MAX_THREADS];
+	static ProfileZoneStats m_Stats[PROFILER_MAX_ZONES];
+	static unsigned int m_StatsCount;
+	static unsigned long long m_FrameNumber;
+	static bool m_FrameOpen;
+};
+
+class ProfileScope {
+public:
+	ProfileScope(const char* name) { Profiler::BeginZone(name); }
+	~ProfileScope() { Profiler::EndZone(); }
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+};
+
+#define EN_PROFILE_CONCAT_INNER(a, b) a##b
+#define EN_PROFILE_CONCAT(a, b) EN_PROFILE_CONCAT_INNER(a, b)
+
+#if EN_PROFILE
+// Names have to outlive the profiler, string literals or __FUNCTION__
+#define EN_PROFILE_SCOPE(name) ProfileScope EN_PROFILE_CONCAT(s_ProfileScope, __LINE__)(name)
+#define EN_PROFILE_FUNCTION() EN_PROFILE_SCOPE(__FUNCTION__)
+#else
+#define EN_PROFILE_SCOPE(name) do { } while (0)
+#define EN_PROFILE_FUNCTION() do { } while (0)
+#endif
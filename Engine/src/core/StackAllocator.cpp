@@ -0,0 +1,115 @@
+#include "StackAllocator.hpp"
+#include "Logger.hpp"
+
+StackAllocator::~StackAllocator() {
+	Destroy();
+}
+
+bool StackAllocator::Create(unsigned long long capacity, MemoryTag tag) {
+	if (m_Memory) {
+		EN_WARN("StackAllocator::Create was called on an allocator that already owns memory.");
+		return false;
+	}
+	m_Memory = (char*)Memory::Allocate(capacity, tag);
+	if (!m_Memory) {
+		EN_ERROR("StackAllocator could not reserve %llu bytes.", capacity);
+		return false;
+	}
+	m_Capacity = capacity;
+	m_Tag = tag;
+	Reset();
+	m_HighWaterMark = 0;
+	return true;
+}
+
+void StackAllocator::Destroy() {
+	if (m_Memory) {
+		Memory::Free(m_Memory, m_Capacity, m_Tag);
+		m_Memory = nullptr;
+	}
+	m_Capacity = 0;
+	m_Bottom = 0;
+	m_Top = 0;
+	m_LastScratch = nullptr;
+}
+
+void* StackAllocator::AllocatePersistent(unsigned long long size, unsigned long long alignment) {
+	// Alignment has to be a power of two
+	unsigned long long address = ((unsigned long long)(m_Memory + m_Bottom) + alignment - 1) & ~(alignment - 1);
+	unsigned long long offset = address - (unsigned long long)m_Memory;
+	if (!m_Memory || offset + size > m_Top) {
+		EN_ERROR("StackAllocator is out of memory. Requested %llu persistent bytes, %llu of %llu in use.", size, m_Bottom + m_Capacity - m_Top, m_Capacity);
+		return nullptr;
+	}
+	m_Bottom = offset + size;
+	updateHighWaterMark();
+	return (void*)address;
+}
+
+void* StackAllocator::AllocateScratch(unsigned long long size, unsigned long long alignment) {
+	if (!m_Memory || size > m_Top - m_Bottom) {
+		EN_ERROR("StackAllocator is out of memory. Requested %llu scratch bytes, %llu of %llu in use.", size, m_Bottom + m_Capacity - m_Top, m_Capacity);
+		return nullptr;
+	}
+	unsigned long long address = ((unsigned long long)(m_Memory + m_Top) - size) & ~(alignment - 1);
+	if (address < (unsigned long long)(m_Memory + m_Bottom)) {
+		EN_ERROR("StackAllocator is out of memory. Requested %llu scratch bytes, %llu of %llu in use.", size, m_Bottom + m_Capacity - m_Top, m_Capacity);
+		return nullptr;
+	}
+	m_Top = address - (unsigned long long)m_Memory;
+	m_LastScratch = (char*)address;
+	updateHighWaterMark();
+	return (void*)address;
+}
+
+void* StackAllocator::ReallocateScratch(void* block, unsigned long long oldSize, unsigned long long newSize, unsigned long long alignment) {
+	if (!block) {
+		return AllocateScratch(newSize, alignment);
+	}
+	if (newSize <= oldSize) {
+		return block;
+	}
+
+	if (block == m_LastScratch) {
+		// Scratch grows down, so keep the end of the block and move its start
+		unsigned long long address = ((unsigned long long)block + oldSize - newSize) & ~(alignment - 1);
+		if (address >= (unsigned long long)(m_Memory + m_Bottom) && address < (unsigned long long)block) {
+			memmove((void*)address, block, oldSize);
+			m_Top = address - (unsigned long long)m_Memory;
+			m_LastScratch = (char*)address;
+			updateHighWaterMark();
+			return (void*)address;
+		}
+	}
+
+	void* moved = AllocateScratch(newSize, alignment);
+	if (moved) {
+		Memory::Copy(moved, block, oldSize);
+	}
+	return moved;
+}
+
+void StackAllocator::FreeToMarker(StackMarker marker) {
+	if (marker.s_Side == STACK_SIDE_PERSISTENT) {
+		if (marker.s_Offset <= m_Bottom) {
+			m_Bottom = marker.s_Offset;
+		}
+	}
+	else if (marker.s_Offset >= m_Top && marker.s_Offset <= m_Capacity) {
+		m_Top = marker.s_Offset;
+		m_LastScratch = nullptr;
+	}
+}
+
+void StackAllocator::Reset() {
+	m_Bottom = 0;
+	m_Top = m_Capacity;
+	m_LastScratch = nullptr;
+}
+
+void StackAllocator::updateHighWaterMark() {
+	unsigned long long used = m_Bottom + m_Capacity - m_Top;
+	if (used > m_HighWaterMark) {
+		m_HighWaterMark = used;
+	}
+}
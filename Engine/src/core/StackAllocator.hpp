@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Memory.hpp"
+
+enum StackSide {
+	// Grows up from the bottom, for data that lives as long as the current level
+	STACK_SIDE_PERSISTENT,
+	// Grows down from the top, for temporary buffers of a single load step
+	STACK_SIDE_SCRATCH
+};
+
+struct StackMarker {
+	unsigned long long s_Offset;
+	StackSide s_Side;
+};
+
+// Double-ended stack over one fixed block. Both ends grow towards each other, so
+// neither side needs its own fixed budget. Memory is never freed individually,
+// a side is rolled back to a marker in O(1) instead. Not thread safe.
+class StackAllocator {
+public:
+	StackAllocator() = default;
+	~StackAllocator();
+	StackAllocator(const StackAllocator&) = delete;
+	StackAllocator& operator=(const StackAllocator&) = delete;
+
+	bool Create(unsigned long long capacity, MemoryTag tag);
+	void Destroy();
+
+	void* AllocatePersistent(unsigned long long size, unsigned long long alignment = 16);
+	void* AllocateScratch(unsigned long long size, unsigned long long alignment = 16);
+	// Grows the block in place if it is the last scratch allocation, otherwise copies it
+	void* ReallocateScratch(void* block, unsigned long long oldSize, unsigned long long newSize, unsigned long long alignment = 16);
+
+	StackMarker GetPersistentMarker() const { return { m_Bottom, STACK_SIDE_PERSISTENT }; }
+	StackMarker GetScratchMarker() const { return { m_Top, STACK_SIDE_SCRATCH }; }
+	// Invalidates everything allocated on the markers side after it was taken
+	void FreeToMarker(StackMarker marker);
+	void ResetScratch() { m_Top = m_Capacity; m_LastScratch = nullptr; }
+	void Reset();
+
+	bool Owns(const void* block) const { return block >= m_Memory && block < m_Memory + m_Capacity; }
+	unsigned long long GetCapacity() const { return m_Capacity; }
+	unsigned long long GetPersistentUsed() const { return m_Bottom; }
+	unsigned long long GetScratchUsed() const { return m_Capacity - m_Top; }
+	unsigned long long GetFree() const { return m_Top - m_Bottom; }
+	unsigned long long GetHighWaterMark() const { return m_HighWaterMark; }
+private:
+	void updateHighWaterMark();
+private:
+	char* m_Memory = nullptr;
+	unsigned long long m_Capacity = 0;
+	// Persistent data is in [0, m_Bottom), scratch data in [m_Top, m_Capacity)
+	unsigned long long m_Bottom = 0;
+	unsigned long long m_Top = 0;
+	unsigned long long m_HighWaterMark = 0;
+	// Start of the most recent scratch allocation, the only one that can grow in place
+	char* m_LastScratch = nullptr;
+	MemoryTag m_Tag = MEMORY_TAG_MAX;
+};
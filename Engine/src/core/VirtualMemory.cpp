@@ -0,0 +1,200 @@
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <stdio.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "VirtualMemory.hpp"
+#include "Logger.hpp"
+
+static const char* pageModeStrings[MEMORY_PAGES_MAX] = {
+	"default",
+	"transparent huge",
+	"huge"
+};
+
+static unsigned long long alignUp(unsigned long long value, unsigned long long alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+const char* VirtualMemory::GetPageModeString(MemoryPageMode mode) {
+	return mode < MEMORY_PAGES_MAX ? pageModeStrings[mode] : "unknown";
+}
+
+#ifdef _WIN32
+
+// Large pages can only be allocated by a process that holds SeLockMemoryPrivilege
+static bool enableLockMemoryPrivilege() {
+	HANDLE token;
+	if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token)) {
+		return false;
+	}
+	TOKEN_PRIVILEGES privileges{};
+	privileges.PrivilegeCount = 1;
+	privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+	bool enabled = LookupPrivilegeValue(nullptr, SE_LOCK_MEMORY_NAME, &privileges.Privileges[0].Luid)
+		&& AdjustTokenPrivileges(token, FALSE, &privileges, 0, nullptr, nullptr)
+		&& GetLastError() == ERROR_SUCCESS;
+	CloseHandle(token);
+	return enabled;
+}
+
+unsigned long long VirtualMemory::GetPageSize() {
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwPageSize;
+}
+
+unsigned long long VirtualMemory::GetHugePageSize() {
+	return GetLargePageMinimum();
+}
+
+bool VirtualMemory::Reserve(VirtualRange& range, unsigned long long size, MemoryPageMode mode) {
+	range = VirtualRange{};
+	if (mode == MEMORY_PAGES_HUGE) {
+		unsigned long long hugePageSize = GetHugePageSize();
+		if (hugePageSize > 0 && enableLockMemoryPrivilege()) {
+			size = alignUp(size, hugePageSize);
+			void* memory = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+			if (memory) {
+				range.s_Base = (char*)memory;
+				range.s_Reserved = size;
+				range.s_Committed = size;
+				range.s_PageSize = hugePageSize;
+				range.s_PageMode = MEMORY_PAGES_HUGE;
+				return true;
+			}
+		}
+		EN_WARN("Large pages are not available (error %lu), using default pages.", GetLastError());
+	}
+
+	range.s_PageSize = GetPageSize();
+	size = alignUp(size, range.s_PageSize);
+	void* memory = VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS);
+	if (!memory) {
+		EN_ERROR("Failed to reserve %llu bytes of address space (error %lu).", size, GetLastError());
+		return false;
+	}
+	range.s_Base = (char*)memory;
+	range.s_Reserved = size;
+	return true;
+}
+
+bool VirtualMemory::Commit(VirtualRange& range, unsigned long long size) {
+	size = alignUp(size, range.s_PageSize);
+	if (size <= range.s_Committed) {
+		return true;
+	}
+	if (size > range.s_Reserved) {
+		return false;
+	}
+	if (!VirtualAlloc(range.s_Base + range.s_Committed, size - range.s_Committed, MEM_COMMIT, PAGE_READWRITE)) {
+		EN_ERROR("Failed to commit %llu bytes (error %lu).", size - range.s_Committed, GetLastError());
+		return false;
+	}
+	range.s_Committed = size;
+	return true;
+}
+
+void VirtualMemory::Release(VirtualRange& range) {
+	if (range.s_Base) {
+		VirtualFree(range.s_Base, 0, MEM_RELEASE);
+	}
+	range = VirtualRange{};
+}
+
+#else
+
+unsigned long long VirtualMemory::GetPageSize() {
+	return (unsigned long long)sysconf(_SC_PAGESIZE);
+}
+
+unsigned long long VirtualMemory::GetHugePageSize() {
+	unsigned long long size = 0;
+	FILE* file = fopen("/proc/meminfo", "r");
+	if (file) {
+		char line[256];
+		while (fgets(line, sizeof(line), file)) {
+			if (sscanf(line, "Hugepagesize: %llu kB", &size) == 1) {
+				size *= 1024;
+				break;
+			}
+		}
+		fclose(file);
+	}
+	return size ? size : 2 * 1024 * 1024;
+}
+
+bool VirtualMemory::Reserve(VirtualRange& range, unsigned long long size, MemoryPageMode mode) {
+	range = VirtualRange{};
+	unsigned long long hugePageSize = GetHugePageSize();
+	if (mode == MEMORY_PAGES_HUGE) {
+		// hugetlb pages are taken from the pool when mapped, so map the whole range readable right away
+		size = alignUp(size, hugePageSize);
+		void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (memory != MAP_FAILED) {
+			range.s_Base = (char*)memory;
+			range.s_Reserved = size;
+			range.s_Committed = size;
+			range.s_PageSize = hugePageSize;
+			range.s_PageMode = MEMORY_PAGES_HUGE;
+			return true;
+		}
+		EN_WARN("Huge pages are not available (is vm.nr_hugepages set?), using transparent huge pages.");
+		mode = MEMORY_PAGES_TRANSPARENT_HUGE;
+	}
+
+	range.s_PageSize = GetPageSize();
+	size = alignUp(size, range.s_PageSize);
+	// Over reserve by one huge page so the base can be aligned, THP only maps aligned 2MB ranges
+	unsigned long long padding = mode == MEMORY_PAGES_TRANSPARENT_HUGE ? hugePageSize : 0;
+	char* memory = (char*)mmap(nullptr, size + padding, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (memory == MAP_FAILED) {
+		EN_ERROR("Failed to reserve %llu bytes of address space.", size);
+		return false;
+	}
+	char* base = memory;
+	if (padding) {
+		base = (char*)alignUp((unsigned long long)memory, hugePageSize);
+		if (base > memory) {
+			munmap(memory, base - memory);
+		}
+		if (memory + padding > base) {
+			munmap(base + size, memory + padding - base);
+		}
+		if (madvise(base, size, MADV_HUGEPAGE) == 0) {
+			range.s_PageMode = MEMORY_PAGES_TRANSPARENT_HUGE;
+		}
+	}
+	range.s_Base = base;
+	range.s_Reserved = size;
+	return true;
+}
+
+bool VirtualMemory::Commit(VirtualRange& range, unsigned long long size) {
+	size = alignUp(size, range.s_PageSize);
+	if (size <= range.s_Committed) {
+		return true;
+	}
+	if (size > range.s_Reserved) {
+		return false;
+	}
+	// Physical pages are still only faulted in on first touch
+	if (mprotect(range.s_Base + range.s_Committed, size - range.s_Committed, PROT_READ | PROT_WRITE) != 0) {
+		EN_ERROR("Failed to commit %llu bytes.", size - range.s_Committed);
+		return false;
+	}
+	range.s_Committed = size;
+	return true;
+}
+
+void VirtualMemory::Release(VirtualRange& range) {
+	if (range.s_Base) {
+		munmap(range.s_Base, range.s_Reserved);
+	}
+	range = VirtualRange{};
+}
+
+#endif
@@ -0,0 +1,35 @@
+#pragma once
+
+enum MemoryPageMode {
+	MEMORY_PAGES_DEFAULT,
+	// Let the OS back the range with huge pages where it can (Linux THP).
+	// Needs no setup, Windows has no equivalent and uses default pages.
+	MEMORY_PAGES_TRANSPARENT_HUGE,
+	// Explicit huge pages. Needs a hugetlbfs pool (Linux) or SeLockMemoryPrivilege (Windows)
+	// and commits the whole range up front, since those pages cannot be committed lazily.
+	MEMORY_PAGES_HUGE,
+	MEMORY_PAGES_MAX
+};
+
+struct VirtualRange {
+	char* s_Base = nullptr;
+	unsigned long long s_Reserved = 0;
+	// Always a prefix of the reserved range
+	unsigned long long s_Committed = 0;
+	unsigned long long s_PageSize = 0;
+	MemoryPageMode s_PageMode = MEMORY_PAGES_DEFAULT;
+};
+
+// Reserves address space up front and backs it with memory as it is needed
+class VirtualMemory {
+public:
+	static unsigned long long GetPageSize();
+	static unsigned long long GetHugePageSize();
+	static const char* GetPageModeString(MemoryPageMode mode);
+
+	// Falls back to default pages if the requested huge pages are not available
+	static bool Reserve(VirtualRange& range, unsigned long long size, MemoryPageMode mode);
+	// Grows the committed prefix to at least size bytes, rounded up to whole pages
+	static bool Commit(VirtualRange& range, unsigned long long size);
+	static void Release(VirtualRange& range);
+};
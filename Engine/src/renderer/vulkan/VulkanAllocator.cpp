@@ -0,0 +1,139 @@
+#include "VulkanAllocator.hpp"
+
+#include "core/Memory.hpp"
+#include "core/Logger.hpp"
+
+// Stored right in front of every pointer handed to the driver, because
+// pfnFree does not tell us the size or scope of the allocation.
+// Its size doubles as the smallest alignment, alignas keeps it a power of two.
+struct alignas(16) VulkanAllocationHeader {
+	unsigned long long s_Size;
+	unsigned long long s_RawSize;
+	unsigned int s_Offset;
+	unsigned int s_Scope;
+};
+
+static const char* scopeStrings[VULKAN_ALLOCATION_SCOPE_COUNT] = {
+	"COMMAND",
+	"OBJECT",
+	"CACHE",
+	"DEVICE",
+	"INSTANCE"
+};
+
+VulkanAllocator::VulkanAllocator() {
+	m_Callbacks.pUserData = this;
+	m_Callbacks.pfnAllocation = allocate;
+	m_Callbacks.pfnReallocation = reallocate;
+	m_Callbacks.pfnFree = deallocate;
+	m_Callbacks.pfnInternalAllocation = internalAllocation;
+	m_Callbacks.pfnInternalFree = internalFree;
+
+	for (unsigned int i = 0; i < VULKAN_ALLOCATION_SCOPE_COUNT; i++) {
+		m_ScopeStats[i].s_CurrentBytes = 0;
+		m_ScopeStats[i].s_PeakBytes = 0;
+		m_ScopeStats[i].s_AllocationCount = 0;
+		m_ScopeStats[i].s_InternalBytes = 0;
+	}
+	m_TotalBytes = 0;
+	m_FrameAllocations = 0;
+}
+
+void VulkanAllocator::beginFrame() {
+	m_LastFrameAllocations = m_FrameAllocations.exchange(0);
+}
+
+void VulkanAllocator::printStats() const {
+	EN_INFO("Vulkan host memory: %llu bytes (budget %llu, 0 = unlimited), %llu allocations last frame.",
+		m_TotalBytes.load(),
+		m_Budget,
+		m_LastFrameAllocations);
+	for (unsigned int i = 0; i < VULKAN_ALLOCATION_SCOPE_COUNT; i++) {
+		EN_INFO("    MEMORY_TAG_RENDERER/%s: %llu bytes, peak %llu bytes, %llu allocations, %llu internal bytes.",
+			scopeStrings[i],
+			m_ScopeStats[i].s_CurrentBytes.load(),
+			m_ScopeStats[i].s_PeakBytes.load(),
+			m_ScopeStats[i].s_AllocationCount.load(),
+			m_ScopeStats[i].s_InternalBytes.load());
+	}
+}
+
+void* VKAPI_CALL VulkanAllocator::allocate(void* userData, size_t size, size_t alignment, VkSystemAllocationScope scope) {
+	VulkanAllocator* allocator = (VulkanAllocator*)userData;
+	if (size == 0) {
+		return nullptr;
+	}
+	if (allocator->m_Budget > 0 && allocator->m_TotalBytes + size > allocator->m_Budget) {
+		EN_WARN("Vulkan host allocation of %llu bytes denied, budget of %llu bytes exhausted.", (unsigned long long)size, allocator->m_Budget);
+		return nullptr;
+	}
+
+	// Reserve room for the header and for moving the pointer up to the requested alignment
+	if (alignment < sizeof(VulkanAllocationHeader)) {
+		alignment = sizeof(VulkanAllocationHeader);
+	}
+	unsigned long long rawSize = (unsigned long long)size + sizeof(VulkanAllocationHeader) + alignment - 1;
+	char* raw = (char*)Memory::Allocate(rawSize, MEMORY_TAG_RENDERER);
+	if (!raw) {
+		return nullptr;
+	}
+	unsigned long long aligned = ((unsigned long long)raw + sizeof(VulkanAllocationHeader) + alignment - 1) & ~(unsigned long long)(alignment - 1);
+
+	VulkanAllocationHeader* header = (VulkanAllocationHeader*)aligned - 1;
+	header->s_Size = size;
+	header->s_RawSize = rawSize;
+	header->s_Offset = (unsigned int)(aligned - (unsigned long long)raw);
+	header->s_Scope = scope;
+
+	VulkanAllocationScopeStats& stats = allocator->m_ScopeStats[scope];
+	unsigned long long current = stats.s_CurrentBytes += size;
+	unsigned long long peak = stats.s_PeakBytes;
+	while (current > peak && !stats.s_PeakBytes.compare_exchange_weak(peak, current)) {}
+	stats.s_AllocationCount++;
+	allocator->m_TotalBytes += size;
+	allocator->m_FrameAllocations++;
+
+	return (void*)aligned;
+}
+
+void* VKAPI_CALL VulkanAllocator::reallocate(void* userData, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope) {
+	if (!original) {
+		return allocate(userData, size, alignment, scope);
+	}
+	if (size == 0) {
+		deallocate(userData, original);
+		return nullptr;
+	}
+
+	// On failure the original allocation has to stay untouched
+	void* memory = allocate(userData, size, alignment, scope);
+	if (memory) {
+		VulkanAllocationHeader* header = (VulkanAllocationHeader*)original - 1;
+		Memory::Copy(memory, original, header->s_Size < size ? header->s_Size : size);
+		deallocate(userData, original);
+	}
+	return memory;
+}
+
+void VKAPI_CALL VulkanAllocator::deallocate(void* userData, void* memory) {
+	if (!memory) {
+		return;
+	}
+	VulkanAllocator* allocator = (VulkanAllocator*)userData;
+	VulkanAllocationHeader* header = (VulkanAllocationHeader*)memory - 1;
+
+	allocator->m_ScopeStats[header->s_Scope].s_CurrentBytes -= header->s_Size;
+	allocator->m_TotalBytes -= header->s_Size;
+
+	Memory::Free((char*)memory - header->s_Offset, header->s_RawSize, MEMORY_TAG_RENDERER);
+}
+
+void VKAPI_CALL VulkanAllocator::internalAllocation(void* userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope) {
+	VulkanAllocator* allocator = (VulkanAllocator*)userData;
+	allocator->m_ScopeStats[scope].s_InternalBytes += size;
+}
+
+void VKAPI_CALL VulkanAllocator::internalFree(void* userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope) {
+	VulkanAllocator* allocator = (VulkanAllocator*)userData;
+	allocator->m_ScopeStats[scope].s_InternalBytes -= size;
+}
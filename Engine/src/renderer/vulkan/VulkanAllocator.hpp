@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <vulkan/vulkan.h>
+
+#define VULKAN_ALLOCATION_SCOPE_COUNT (VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1)
+
+struct VulkanAllocationScopeStats {
+	std::atomic<unsigned long long> s_CurrentBytes;
+	std::atomic<unsigned long long> s_PeakBytes;
+	std::atomic<unsigned long long> s_AllocationCount;
+	// Memory the driver allocated on its own and only reported to us
+	std::atomic<unsigned long long> s_InternalBytes;
+};
+
+// Routes the drivers host allocations through Memory (MEMORY_TAG_RENDERER)
+// and keeps a breakdown per VkSystemAllocationScope.
+class VulkanAllocator {
+public:
+	VulkanAllocator();
+	VulkanAllocator(const VulkanAllocator&) = delete;
+	VulkanAllocator& operator=(const VulkanAllocator&) = delete;
+
+	VkAllocationCallbacks* getCallbacks() { return &m_Callbacks; }
+
+	// Caps the bytes the driver may hold through us. 0 means unlimited.
+	void setBudget(unsigned long long bytes) { m_Budget = bytes; }
+
+	// Called once per frame so allocations made inside the frame loop can be spotted
+	void beginFrame();
+	unsigned long long getLastFrameAllocations() const { return m_LastFrameAllocations; }
+
+	void printStats() const;
+private:
+	static void* VKAPI_CALL allocate(void* userData, size_t size, size_t alignment, VkSystemAllocationScope scope);
+	static void* VKAPI_CALL reallocate(void* userData, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope);
+	static void VKAPI_CALL deallocate(void* userData, void* memory);
+	static void VKAPI_CALL internalAllocation(void* userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+	static void VKAPI_CALL internalFree(void* userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+private:
+	VkAllocationCallbacks m_Callbacks{};
+	VulkanAllocationScopeStats m_ScopeStats[VULKAN_ALLOCATION_SCOPE_COUNT];
+
+	unsigned long long m_Budget = 0;
+	std::atomic<unsigned long long> m_TotalBytes;
+	std::atomic<unsigned long long> m_FrameAllocations;
+	unsigned long long m_LastFrameAllocations = 0;
+};
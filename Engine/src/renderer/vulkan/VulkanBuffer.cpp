@@ -13,6 +13,16 @@
 #include "core/Memory.hpp"
 #include "core/Logger.hpp"
 
+PoolAllocator<VulkanBuffer> VulkanBuffer::m_Pool("VulkanBuffer", MEMORY_TAG_RENDERER);
+
+void* VulkanBuffer::operator new(size_t size) {
+	return m_Pool.AllocateObject(size);
+}
+
+void VulkanBuffer::operator delete(void* block) {
+	m_Pool.Free(block);
+}
+
 VulkanBuffer::VulkanBuffer(const VulkanDevice& device,
 	VkDeviceSize size,
 	VkBufferUsageFlagBits usage,
@@ -85,11 +95,11 @@ VulkanBuffer::~VulkanBuffer() {
 	//EN_INFO("Freed vulkan memory with address: %p.", &m_Memory);
 }
 
-VertexBuffer::VertexBuffer(std::vector<Vertex>* vertices,
+VertexBuffer::VertexBuffer(DArray<Vertex>&& vertices,
 	const VulkanDevice& device,
 	const VkAllocationCallbacks& allocator)
-	: m_Device(device), m_Allocator(allocator), m_Vertices(vertices) {
-	if (vertices->size() == 0) {
+	: m_Device(device), m_Allocator(allocator), m_Vertices(std::move(vertices)) {
+	if (m_Vertices.Size() == 0) {
 		EN_WARN("CreateVertexBuffer was called with an empty set of vertices. Nothing happens.");
 	}
 
@@ -119,14 +129,14 @@ VertexBuffer::VertexBuffer(std::vector<Vertex>* vertices,
 	attributeDescriptions[2].offset = offsetof(Vertex, s_TexCoord);
 
 	// Copy the produced data to the buffer
-	m_AttributeDescriptions.push_back(attributeDescriptions[0]);
-	m_AttributeDescriptions.push_back(attributeDescriptions[1]);
-	m_AttributeDescriptions.push_back(attributeDescriptions[2]);
+	m_AttributeDescriptions.PushBack(attributeDescriptions[0]);
+	m_AttributeDescriptions.PushBack(attributeDescriptions[1]);
+	m_AttributeDescriptions.PushBack(attributeDescriptions[2]);
 
 	m_BindingDescription = bindingDescription;
 
 	// First calculate and set the buffer size.
-	size_t bufferSize = m_Vertices->size() * sizeof(m_Vertices[0]);
+	size_t bufferSize = m_Vertices.Size() * sizeof(Vertex);
 
 	VulkanBuffer stagingBuffer(m_Device,
 		bufferSize,
@@ -142,7 +152,7 @@ VertexBuffer::VertexBuffer(std::vector<Vertex>* vertices,
 		bufferSize,
 		0,
 		&data);
-	memcpy(data, m_Vertices->data(), m_Vertices->size() * sizeof(m_Vertices[0]));
+	Memory::CopyToMapped(data, m_Vertices.Data(), bufferSize);
 	vkUnmapMemory(m_Device.m_LogicalDevice, stagingBuffer.m_Memory);
 
 	m_InternalBuffer = new VulkanBuffer(m_Device,
@@ -161,7 +171,7 @@ VertexBuffer::VertexBuffer(std::vector<Vertex>* vertices,
 	// end of this method
 }
 
-std::vector<Vertex>* VertexBuffer::generatePlaneData(unsigned int width, unsigned int height, unsigned int fieldWidth, unsigned int fieldHeight) {
+DArray<Vertex> VertexBuffer::generatePlaneData(unsigned int width, unsigned int height, unsigned int fieldWidth, unsigned int fieldHeight) {
 	/*for (unsigned int i = 0; i < height; i++) {
 		for (unsigned int j = 0; j < width; j++) {
 			glm::vec3 v = { i* fieldWidth, j* fieldHeight, Random::GetRandomNumberInWholeRange(-1, 1) };
@@ -169,38 +179,38 @@ std::vector<Vertex>* VertexBuffer::generatePlaneData(unsigned int width, unsigne
 			outBuffer->s_Vertices.PushBack({ v,c });
 		}
 	}*/
-	std::vector<Vertex>* vertices = new std::vector<Vertex>();
-	vertices->push_back({ {-0.5f, -0.5f, 0.0f}, { 1.0f, 0.0f, 0.0f}, {1.0f, 0.0f} });
-	vertices->push_back({ {0.5f, -0.5f, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f} });
-	vertices->push_back({ {0.5f, 0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 1.0f} });
-	vertices->push_back({ {-0.5f, 0.5f, 0.0f}, {1.0f, 1.0f, 1.0f}, {1.0f, 1.0f} });
-
-	vertices->push_back({ {-0.5f, -0.5f, 1.0f}, { 1.0f, 0.0f, 0.0f}, {1.0f, 0.0f} });
-	vertices->push_back({ {0.5f, -0.5f, 1.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f} });
-	vertices->push_back({ {0.5f, 0.5f, 1.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 1.0f} });
-	vertices->push_back({ {-0.5f, 0.5f, 1.0f}, {1.0f, 1.0f, 1.0f}, {1.0f, 1.0f} });
+	DArray<Vertex> vertices;
+	vertices.Reserve(8);
+	vertices.PushBack({ {-0.5f, -0.5f, 0.0f}, { 1.0f, 0.0f, 0.0f}, {1.0f, 0.0f} });
+	vertices.PushBack({ {0.5f, -0.5f, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f} });
+	vertices.PushBack({ {0.5f, 0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 1.0f} });
+	vertices.PushBack({ {-0.5f, 0.5f, 0.0f}, {1.0f, 1.0f, 1.0f}, {1.0f, 1.0f} });
+
+	vertices.PushBack({ {-0.5f, -0.5f, 1.0f}, { 1.0f, 0.0f, 0.0f}, {1.0f, 0.0f} });
+	vertices.PushBack({ {0.5f, -0.5f, 1.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f} });
+	vertices.PushBack({ {0.5f, 0.5f, 1.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 1.0f} });
+	vertices.PushBack({ {-0.5f, 0.5f, 1.0f}, {1.0f, 1.0f, 1.0f}, {1.0f, 1.0f} });
 	/*for (int i = 0; i < 8; i++) {
-		vertices->push_back({ {0 + float(i * 8), 1 + float(i * 8), 2 + float(i * 8)}, { 3 + float(i * 8), 4 + float(i * 8), 5 + float(i * 8)}, {6 + float(i * 8), 7 + float(i * 8)} });
+		vertices.PushBack({ {0 + float(i * 8), 1 + float(i * 8), 2 + float(i * 8)}, { 3 + float(i * 8), 4 + float(i * 8), 5 + float(i * 8)}, {6 + float(i * 8), 7 + float(i * 8)} });
 	}*/
 	return vertices;
 }
 
 VertexBuffer::~VertexBuffer() {
 	delete m_InternalBuffer;
-	delete m_Vertices;
 	EN_DEBUG("Vertex buffer destroyed.");
 }
 
 
-IndexBuffer::IndexBuffer(std::vector<unsigned int>* indices,
+IndexBuffer::IndexBuffer(DArray<unsigned int>&& indices,
 	const VulkanDevice& device,
 	const VkAllocationCallbacks& allocator)
-	: m_Indices(indices), m_Device(device), m_Allocator(allocator) {
-	if (m_Indices->size() == 0) {
+	: m_Indices(std::move(indices)), m_Device(device), m_Allocator(allocator) {
+	if (m_Indices.Size() == 0) {
 		EN_WARN("CreateIndexBuffer was called with an empty set of vertices. Nothing happens.");
 	}
 	// Calculate and set index buffer size
-	size_t bufferSize = sizeof(unsigned int) * m_Indices->size();
+	size_t bufferSize = sizeof(unsigned int) * m_Indices.Size();
 
 	VulkanBuffer stagingBuffer(m_Device,
 		bufferSize,
@@ -215,7 +225,7 @@ IndexBuffer::IndexBuffer(std::vector<unsigned int>* indices,
 		bufferSize,
 		0,
 		&data);
-	memcpy(data, m_Indices->data(), bufferSize);
+	Memory::CopyToMapped(data, m_Indices.Data(), bufferSize);
 	vkUnmapMemory(m_Device.m_LogicalDevice,
 		stagingBuffer.m_Memory);
 
@@ -232,28 +242,28 @@ IndexBuffer::IndexBuffer(std::vector<unsigned int>* indices,
 	EN_INFO("Index buffer created.");
 }
 
-std::vector<unsigned int>* IndexBuffer::generateExampleIndices() {
-	std::vector<unsigned int>* indices = new std::vector<unsigned int>();
-	indices->push_back(0);
-	indices->push_back(1);
-	indices->push_back(2);
-	indices->push_back(2);
-	indices->push_back(3);
-	indices->push_back(0);
-
-	indices->push_back(4);
-	indices->push_back(5);
-	indices->push_back(6);
-	indices->push_back(6);
-	indices->push_back(7);
-	indices->push_back(4);
+DArray<unsigned int> IndexBuffer::generateExampleIndices() {
+	DArray<unsigned int> indices;
+	indices.Reserve(12);
+	indices.PushBack(0);
+	indices.PushBack(1);
+	indices.PushBack(2);
+	indices.PushBack(2);
+	indices.PushBack(3);
+	indices.PushBack(0);
+
+	indices.PushBack(4);
+	indices.PushBack(5);
+	indices.PushBack(6);
+	indices.PushBack(6);
+	indices.PushBack(7);
+	indices.PushBack(4);
 
 	return indices;
 }
 
 IndexBuffer::~IndexBuffer() {
 	delete m_InternalBuffer;
-	delete m_Indices;
 	EN_DEBUG("Index buffer destroyed.");
 }
 
@@ -261,8 +271,8 @@ UniformBuffer::UniformBuffer(unsigned int framesInFlight, const VulkanDevice& de
 	: m_Device(device), m_Allocator(allocator) {
 	VkDeviceSize bufferSize = sizeof(UniformBufferObject);
 
-	m_Buffers.resize(framesInFlight);
-	m_UniformBuffersMapped.resize(framesInFlight);
+	m_Buffers.Resize(framesInFlight);
+	m_UniformBuffersMapped.Resize(framesInFlight);
 
 	for (unsigned int i = 0; i < framesInFlight; i++) {
 		m_Buffers[i] = new VulkanBuffer(device,
@@ -281,7 +291,7 @@ UniformBuffer::UniformBuffer(unsigned int framesInFlight, const VulkanDevice& de
 }
 
 UniformBuffer::~UniformBuffer() {
-	for (unsigned int i = 0; i < m_Buffers.size(); i++) {
+	for (unsigned int i = 0; i < m_Buffers.Size(); i++) {
 		delete m_Buffers[i];
 	}
 	EN_DEBUG("Uniform buffer destroyed.");
@@ -303,5 +313,5 @@ void UniformBuffer::update(unsigned int width, unsigned int height, unsigned int
 		10.0f);
 	ubo.s_Proj[1][1] *= -1;
 
-	Memory::Copy(m_UniformBuffersMapped[currentFrame], &ubo, sizeof(ubo));
+	Memory::CopyToMapped(m_UniformBuffersMapped[currentFrame], &ubo, sizeof(ubo));
 }
\ No newline at end of file
@@ -3,10 +3,11 @@
 
 #include <vulkan/vulkan.h>
 #include <glm/glm.hpp>
-#include <vector>
 
 #include "renderer/UniformBufferObject.hpp"
+#include "containers/DArray.hpp"
 #include "VulkanDevice.hpp"
+#include "core/PoolAllocator.hpp"
 
 struct Vertex {
 	glm::vec3 s_Position;
@@ -25,6 +26,10 @@ public:
 	bool copyBuffer(VkBuffer dstBuffer, VkDeviceSize size, VkQueue queue);
 	~VulkanBuffer();
 	static int findMemoryType(const VulkanDevice& device, unsigned int typeFilter, VkMemoryPropertyFlags properties);
+
+	// Allocated from a pool instead of the system heap
+	static void* operator new(size_t size);
+	static void operator delete(void* block);
 public:
 	VkBuffer m_Handle{};
 	VkDeviceMemory m_Memory{};
@@ -32,39 +37,41 @@ private:
 	const VulkanDevice& m_Device;
 	const VkAllocationCallbacks& m_Allocator;
 	VkDeviceSize m_Size = 0;
+
+	static PoolAllocator<VulkanBuffer> m_Pool;
 };
 
 class VertexBuffer {
 public:
 	VertexBuffer() = delete;
-	VertexBuffer(std::vector<Vertex>* vertices,
+	VertexBuffer(DArray<Vertex>&& vertices,
 				 const VulkanDevice& device,
 				 const VkAllocationCallbacks& allocator);
-	static std::vector<Vertex>* generatePlaneData(unsigned int width,
+	static DArray<Vertex> generatePlaneData(unsigned int width,
 						   unsigned int height,
 						   unsigned int fieldWidth,
 						   unsigned int fieldHeight);
 	~VertexBuffer();
 public:
 	VulkanBuffer* m_InternalBuffer;
-	std::vector<VkVertexInputAttributeDescription> m_AttributeDescriptions;
+	DArray<VkVertexInputAttributeDescription, 3> m_AttributeDescriptions;
 	VkVertexInputBindingDescription m_BindingDescription{ };
 private:
 	const VulkanDevice& m_Device;
 	const VkAllocationCallbacks& m_Allocator;
-	std::vector<Vertex>* m_Vertices;
+	DArray<Vertex> m_Vertices;
 };
 
 class IndexBuffer {
 public:
-	IndexBuffer(std::vector<unsigned int>* indices,
+	IndexBuffer(DArray<unsigned int>&& indices,
 				const VulkanDevice& device,
 				const VkAllocationCallbacks& allocator);
 	~IndexBuffer();
-	static std::vector<unsigned int>* generateExampleIndices();
+	static DArray<unsigned int> generateExampleIndices();
 public:
 	VulkanBuffer* m_InternalBuffer;
-	std::vector<unsigned int>* m_Indices;
+	DArray<unsigned int> m_Indices;
 private:
 	const VulkanDevice& m_Device;
 	const VkAllocationCallbacks& m_Allocator;
@@ -76,10 +83,10 @@ public:
 	~UniformBuffer();
 	void update(unsigned int width, unsigned int height, unsigned int currentFrame);
 public:
-	std::vector<VulkanBuffer*> m_Buffers;
+	DArray<VulkanBuffer*, 3> m_Buffers;
 private:
 	const VulkanDevice& m_Device;
 	const VkAllocationCallbacks& m_Allocator;
-	std::vector<void*> m_UniformBuffersMapped;
+	DArray<void*, 3> m_UniformBuffersMapped;
 	UniformBufferObject s_BufferObject{};
 };
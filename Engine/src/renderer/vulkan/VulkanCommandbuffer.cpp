@@ -3,6 +3,16 @@
 
 #include "core/Logger.hpp"
 
+PoolAllocator<VulkanCommandbuffer> VulkanCommandbuffer::m_ObjectPool("VulkanCommandbuffer", MEMORY_TAG_RENDERER);
+
+void* VulkanCommandbuffer::operator new(size_t size) {
+	return m_ObjectPool.AllocateObject(size);
+}
+
+void VulkanCommandbuffer::operator delete(void* block) {
+	m_ObjectPool.Free(block);
+}
+
 VulkanCommandbuffer::VulkanCommandbuffer(const VulkanDevice& device, const VkCommandPool& pool) 
 	: m_Device(device), m_Pool(pool) {
 	VkCommandBufferAllocateInfo allocInfo{};
@@ -1,6 +1,7 @@
 #pragma once
 #include <vulkan/vulkan.h>
 #include "VulkanDevice.hpp"
+#include "core/PoolAllocator.hpp"
 
 enum VulkanCommandbufferState {
 	COMMAND_BUFFER_RECORDING,
@@ -19,9 +20,15 @@ public:
 									 const VulkanDevice& device,
 									 const VkCommandPool& pool);
 	// No Destroy() because Vulkan frees the buffers automatically when destroying the command pool
+
+	// Allocated from a pool instead of the system heap
+	static void* operator new(size_t size);
+	static void operator delete(void* block);
 public:
 	VkCommandBuffer m_Handle;
 private:
 	const VulkanDevice& m_Device;
 	const VkCommandPool& m_Pool;
+
+	static PoolAllocator<VulkanCommandbuffer> m_ObjectPool;
 };
\ No newline at end of file
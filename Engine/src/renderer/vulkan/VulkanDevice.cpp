@@ -100,11 +100,11 @@ VulkanDevice::~VulkanDevice() {
 }
 
 VkFormat VulkanDevice::findDepthFormat() const {
-	// Format candidates
-	std::vector<VkFormat> candidates;
-	candidates.push_back(VK_FORMAT_D32_SFLOAT);
-	candidates.push_back(VK_FORMAT_D32_SFLOAT_S8_UINT);
-	candidates.push_back(VK_FORMAT_D24_UNORM_S8_UINT);
+	// Format candidates (stack array, this is called on every swapchain recreation)
+	Array<VkFormat, 3> candidates;
+	candidates[0] = VK_FORMAT_D32_SFLOAT;
+	candidates[1] = VK_FORMAT_D32_SFLOAT_S8_UINT;
+	candidates[2] = VK_FORMAT_D24_UNORM_S8_UINT;
 
 	unsigned int sizes[3] = {
 		4,
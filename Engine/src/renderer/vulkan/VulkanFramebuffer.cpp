@@ -6,6 +6,16 @@
 #include "core/Logger.hpp"
 #include "containers/Array.hpp"
 
+PoolAllocator<VulkanFramebuffer> VulkanFramebuffer::m_Pool("VulkanFramebuffer", MEMORY_TAG_RENDERER);
+
+void* VulkanFramebuffer::operator new(size_t size) {
+	return m_Pool.AllocateObject(size);
+}
+
+void VulkanFramebuffer::operator delete(void* block) {
+	m_Pool.Free(block);
+}
+
 VulkanFramebuffer::VulkanFramebuffer(const VulkanFramebufferConfig& config) 
 	: m_Device(config.s_Device), m_Allocator(config.s_Allocator) {
 
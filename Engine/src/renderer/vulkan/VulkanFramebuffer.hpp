@@ -2,6 +2,7 @@
 #include <vulkan/vulkan.h>
 #include "VulkanRenderpass.hpp"
 #include "VulkanImage.hpp"
+#include "core/PoolAllocator.hpp"
 
 class VulkanSwapchain;
 
@@ -22,9 +23,15 @@ public:
 	VulkanFramebuffer() = delete;
 	VulkanFramebuffer(const VulkanFramebufferConfig& config);
 	~VulkanFramebuffer();
+
+	// Allocated from a pool instead of the system heap
+	static void* operator new(size_t size);
+	static void operator delete(void* block);
 public:
 	VkFramebuffer m_Handle;
 private:
 	const VkAllocationCallbacks& m_Allocator;
 	const VulkanDevice& m_Device;
+
+	static PoolAllocator<VulkanFramebuffer> m_Pool;
 };
\ No newline at end of file
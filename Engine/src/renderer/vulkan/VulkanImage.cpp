@@ -1,6 +1,20 @@
+#include <stdlib.h>
+
+#include "core/StackAllocator.hpp"
+
+// stb_image allocates its decode buffers and the returned pixels through these. They
+// come from the scratch side of the load stack, which is rolled back after the upload.
+// Requests that do not fit go to the system heap.
+static void* stbiAllocate(size_t size);
+static void* stbiReallocate(void* block, size_t oldSize, size_t newSize);
+static void stbiFree(void* block);
+
 #ifndef STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
 #endif
+#define STBI_MALLOC(size) stbiAllocate(size)
+#define STBI_REALLOC_SIZED(block, oldSize, newSize) stbiReallocate(block, oldSize, newSize)
+#define STBI_FREE(block) stbiFree(block)
 
 #include <stb_image.h>
 
@@ -27,6 +41,8 @@ VulkanImage::VulkanImage(const VulkanImageConfig& config)
 			break;
 		}
 		case VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT: {
+			StackAllocator& loadStack = Memory::GetLoadStack();
+			StackMarker loadMarker = loadStack.GetScratchMarker();
 			stbi_uc* pixels = stbi_load("assets/textures/texture.jpg", &m_Width, &m_Height, &m_Channels, STBI_rgb_alpha);
 			VkDeviceSize imageSize = (VkDeviceSize)(m_Width * m_Height * 4);
 
@@ -44,11 +60,12 @@ VulkanImage::VulkanImage(const VulkanImageConfig& config)
 			// Copy pixel data to staging buffer
 			void* data;
 			vkMapMemory(m_Device.m_LogicalDevice, stagingBuffer.m_Memory, 0, imageSize, 0, &data);
-			Memory::Copy(data, pixels, (unsigned int)imageSize);
+			Memory::CopyToMapped(data, pixels, imageSize);
 			vkUnmapMemory(m_Device.m_LogicalDevice, stagingBuffer.m_Memory);
 
-			// Clean up pixel data
+			// Clean up pixel data and every buffer the decoder left on the load stack
 			stbi_image_free(pixels);
+			loadStack.FreeToMarker(loadMarker);
 
 			// TODO: Should use config width and height. When a texture system is in place it will load
 			// the texture from disk and provide the width and height for the vulkan image from outside.
@@ -117,7 +134,7 @@ bool VulkanImage::createImage(const VulkanImageConfig& config) {
 	allocInfo.allocationSize = memRequirements.size;
 	allocInfo.memoryTypeIndex = VulkanBuffer::findMemoryType(m_Device, memRequirements.memoryTypeBits, config.s_Properties);
 
-	if (vkAllocateMemory(m_Device.m_LogicalDevice, &allocInfo, nullptr, &m_Memory) != VK_SUCCESS) {
+	if (vkAllocateMemory(m_Device.m_LogicalDevice, &allocInfo, &m_Allocator, &m_Memory) != VK_SUCCESS) {
 		EN_ERROR("Failed to allocate image memory.");
 		return false;
 	}
@@ -299,4 +316,37 @@ VulkanImage::~VulkanImage() {
 	vkDestroyImage(m_Device.m_LogicalDevice, m_Handle, &m_Allocator);
 	vkFreeMemory(m_Device.m_LogicalDevice, m_Memory, &m_Allocator);
 	EN_DEBUG("Vulkan image destroyed.");
-}
\ No newline at end of file
+}
+
+static void* stbiAllocate(size_t size) {
+	StackAllocator& loadStack = Memory::GetLoadStack();
+	if (size + 16 <= loadStack.GetFree()) {
+		return loadStack.AllocateScratch(size);
+	}
+	return malloc(size);
+}
+
+static void* stbiReallocate(void* block, size_t oldSize, size_t newSize) {
+	StackAllocator& loadStack = Memory::GetLoadStack();
+	if (!loadStack.Owns(block)) {
+		return block ? realloc(block, newSize) : stbiAllocate(newSize);
+	}
+	if (newSize + 16 <= loadStack.GetFree()) {
+		void* moved = loadStack.ReallocateScratch(block, oldSize, newSize);
+		if (moved) {
+			return moved;
+		}
+	}
+	void* moved = malloc(newSize);
+	if (moved) {
+		Memory::Copy(moved, block, oldSize);
+	}
+	return moved;
+}
+
+static void stbiFree(void* block) {
+	// Scratch blocks are released all at once by rolling back the load stack
+	if (!Memory::GetLoadStack().Owns(block)) {
+		free(block);
+	}
+}
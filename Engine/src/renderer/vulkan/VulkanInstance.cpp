@@ -50,6 +50,9 @@ VulkanInstance::VulkanInstance(const VulkanInstanceConfig& instanceConfig) {
 }
 
 void VulkanInstance::create(const VulkanInstanceConfig& instanceConfig) {
+	// Everything created from this instance allocates host memory through the engine
+	m_Allocator = m_HostAllocator.getCallbacks();
+
 	// Get Application data
 	VkApplicationInfo appInfo{};
 	appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
@@ -73,13 +76,13 @@ void VulkanInstance::create(const VulkanInstanceConfig& instanceConfig) {
 
 	EN_INFO("Available extensions:");
 	for (unsigned int i = 0; i < extensionCount; i++) {
-		EN_INFO(availableExtensions[i].extensionName);
+		EN_INFO("%s", availableExtensions[i].extensionName);
 	}
 
 	EN_DEBUG("Required extensions: ");
 	// Output required extension
 	for (unsigned int i = 0; i < instanceConfig.s_Extensions.size(); i++) {
-		EN_DEBUG(instanceConfig.s_Extensions[i]);
+		EN_DEBUG("%s", instanceConfig.s_Extensions[i]);
 	}
 
 	createInfo.enabledExtensionCount = (uint32_t)instanceConfig.s_Extensions.size();
@@ -4,6 +4,8 @@
 #include <windows.h>
 #include <vulkan/vulkan.h>
 
+#include "VulkanAllocator.hpp"
+
 struct VulkanInstanceConfig {
 	std::vector<const char*> s_Extensions;
 	std::vector<const char*> s_ValidationLayers;
@@ -22,6 +24,8 @@ private:
 	void create(const VulkanInstanceConfig& instanceConfig);
 	bool createDebugMessenger(const VkInstance& instance, VkDebugUtilsMessengerEXT* debugMessenger);
 public:
+	// Host allocation callbacks handed to every vulkan call, backed by m_HostAllocator
+	VulkanAllocator m_HostAllocator;
 	VkAllocationCallbacks* m_Allocator = nullptr;
 #ifdef _DEBUG
 	VkDebugUtilsMessengerEXT m_DebugMessenger{};
@@ -5,7 +5,9 @@
 #include "VulkanFramebuffer.hpp"
 
 #include "core/File.hpp"
+#include "core/StackAllocator.hpp"
 #include "containers/Array.hpp"
+#include "containers/ScratchArray.hpp"
 #include "core/Logger.hpp"
 
 VulkanPipeline::VulkanPipeline(const VulkanPipelineConfig& config)
@@ -22,17 +24,30 @@ VulkanPipeline::VulkanPipeline(const VulkanPipelineConfig& config)
 	vertexShader.Open("assets/shaders/MaterialShader.vert.spv", FILE_MODE_READ, true);
 	fragmentShader.Open("assets/shaders/MaterialShader.frag.spv", FILE_MODE_READ, true);
 
-	std::vector<char> vertexShaderSource;
-	vertexShaderSource.resize(vertexShader.Size());
-	std::vector<char> fragmentShaderSource;
-	fragmentShaderSource.resize(fragmentShader.Size());
+	// The code is only needed until the modules are created, keep it on the load stack
+	StackAllocator& loadStack = Memory::GetLoadStack();
+	StackMarker loadMarker = loadStack.GetScratchMarker();
+	char* vertexShaderSource = (char*)loadStack.AllocateScratch(vertexShader.Size(), sizeof(uint32_t));
+	char* fragmentShaderSource = (char*)loadStack.AllocateScratch(fragmentShader.Size(), sizeof(uint32_t));
+	if (!vertexShaderSource || !fragmentShaderSource) {
+		EN_ERROR("Not enough load stack memory to read the shader code.");
+		vertexShader.Close();
+		fragmentShader.Close();
+		loadStack.FreeToMarker(loadMarker);
+		return;
+	}
 
-	vertexShader.ReadAllBytes(vertexShaderSource.data());
-	fragmentShader.ReadAllBytes(fragmentShaderSource.data());
+	bool read = vertexShader.ReadAllBytes(vertexShaderSource) && fragmentShader.ReadAllBytes(fragmentShaderSource);
 
 	vertexShader.Close();
 	fragmentShader.Close();
 
+	if (!read) {
+		EN_ERROR("Cannot read the shader code.");
+		loadStack.FreeToMarker(loadMarker);
+		return;
+	}
+
 	// Shader modules
 	VkShaderModule vertexModule, fragmentModule;
 
@@ -40,7 +55,7 @@ VulkanPipeline::VulkanPipeline(const VulkanPipelineConfig& config)
 	VkShaderModuleCreateInfo vertexCreateInfo{};
 	vertexCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
 	vertexCreateInfo.codeSize = vertexShader.Size();
-	vertexCreateInfo.pCode = reinterpret_cast<const uint32_t*>(vertexShaderSource.data());
+	vertexCreateInfo.pCode = reinterpret_cast<const uint32_t*>(vertexShaderSource);
 
 	VK_CHECK(vkCreateShaderModule(m_Device.m_LogicalDevice,
 								  &vertexCreateInfo,
@@ -51,13 +66,16 @@ VulkanPipeline::VulkanPipeline(const VulkanPipelineConfig& config)
 	VkShaderModuleCreateInfo fragmentCreateInfo{};
 	fragmentCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
 	fragmentCreateInfo.codeSize = fragmentShader.Size();
-	fragmentCreateInfo.pCode = reinterpret_cast<const uint32_t*>(fragmentShaderSource.data());
+	fragmentCreateInfo.pCode = reinterpret_cast<const uint32_t*>(fragmentShaderSource);
 
 	VK_CHECK(vkCreateShaderModule(m_Device.m_LogicalDevice,
 								  &fragmentCreateInfo,
 								  &m_Allocator,
 								  &fragmentModule));
 
+	// Modules keep their own copy of the code
+	loadStack.FreeToMarker(loadMarker);
+
 	// Shader stage creation vertex
 	VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
 	vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -86,9 +104,9 @@ VulkanPipeline::VulkanPipeline(const VulkanPipelineConfig& config)
 	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 	// TODO not hardcode this dude
 	vertexInputInfo.vertexBindingDescriptionCount = 1;
-	vertexInputInfo.vertexAttributeDescriptionCount = (uint32_t) config.s_VertexBuffer.m_AttributeDescriptions.size();
+	vertexInputInfo.vertexAttributeDescriptionCount = (uint32_t) config.s_VertexBuffer.m_AttributeDescriptions.Size();
 	vertexInputInfo.pVertexBindingDescriptions = &config.s_VertexBuffer.m_BindingDescription;
-	vertexInputInfo.pVertexAttributeDescriptions = &config.s_VertexBuffer.m_AttributeDescriptions[0];
+	vertexInputInfo.pVertexAttributeDescriptions = config.s_VertexBuffer.m_AttributeDescriptions.Data();
 
 	// Input assembly
 	VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
@@ -230,8 +248,8 @@ void VulkanPipeline::bind(VulkanCommandbuffer* commandbuffer) {
 }
 
 bool VulkanPipeline::createDescriptorPool() {
-	std::vector<VkDescriptorPoolSize> poolSizes;
-	poolSizes.resize(2);
+	ScratchArray<VkDescriptorPoolSize> poolSizes(2);
+	poolSizes.Resize(2);
 
 	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
 	poolSizes[0].descriptorCount = static_cast<uint32_t>(m_FramesInFlight);
@@ -241,7 +259,7 @@ bool VulkanPipeline::createDescriptorPool() {
 	VkDescriptorPoolCreateInfo poolInfo{};
 	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
 	poolInfo.poolSizeCount = 2;
-	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.pPoolSizes = poolSizes.Data();
 	poolInfo.maxSets = static_cast<uint32_t>(m_FramesInFlight);
 
 	VK_CHECK(vkCreateDescriptorPool(m_Device.m_LogicalDevice, &poolInfo, &m_Allocator, &m_DescriptorPool));
@@ -250,16 +268,16 @@ bool VulkanPipeline::createDescriptorPool() {
 
 bool VulkanPipeline::createDescriptorSets(const VkImageView& imageView, const UniformBuffer& uniformBuffer, const VkSampler& sampler) {
 	// This surely breaks something I guess
-	std::vector<VkDescriptorSetLayout> layouts;
+	ScratchArray<VkDescriptorSetLayout> layouts(m_FramesInFlight);
 	for (unsigned int i = 0; i < m_FramesInFlight; i++) {
-		layouts.push_back(m_DescriptorSetLayout);
+		layouts.PushBack(m_DescriptorSetLayout);
 	}
 
 	VkDescriptorSetAllocateInfo allocInfo{};
 	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
 	allocInfo.descriptorPool = m_DescriptorPool;
 	allocInfo.descriptorSetCount = static_cast<uint32_t>(m_FramesInFlight);
-	allocInfo.pSetLayouts = layouts.data();
+	allocInfo.pSetLayouts = layouts.Data();
 
 	m_DescriptorSets.resize(m_FramesInFlight);
 	VK_CHECK(vkAllocateDescriptorSets(m_Device.m_LogicalDevice, &allocInfo, m_DescriptorSets.data()));
@@ -275,8 +293,8 @@ bool VulkanPipeline::createDescriptorSets(const VkImageView& imageView, const Un
 		imageInfo.imageView = imageView;
 		imageInfo.sampler = sampler;
 
-		std::vector<VkWriteDescriptorSet> descriptorWrites;
-		descriptorWrites.resize(2);
+		ScratchArray<VkWriteDescriptorSet> descriptorWrites(2);
+		descriptorWrites.Resize(2);
 
 		descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 		descriptorWrites[0].dstSet = m_DescriptorSets[i];
@@ -294,7 +312,7 @@ bool VulkanPipeline::createDescriptorSets(const VkImageView& imageView, const Un
 		descriptorWrites[1].descriptorCount = 1;
 		descriptorWrites[1].pImageInfo = &imageInfo;
 
-		vkUpdateDescriptorSets(m_Device.m_LogicalDevice, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+		vkUpdateDescriptorSets(m_Device.m_LogicalDevice, static_cast<uint32_t>(descriptorWrites.Size()), descriptorWrites.Data(), 0, nullptr);
 	}
 	return true;
 }
@@ -331,7 +349,7 @@ bool VulkanPipeline::createDescriptorSetLayout() {
 }
 
 VulkanPipeline::~VulkanPipeline() {
-	vkDestroyDescriptorPool(m_Device.m_LogicalDevice, m_DescriptorPool, nullptr);
+	vkDestroyDescriptorPool(m_Device.m_LogicalDevice, m_DescriptorPool, &m_Allocator);
 	vkDestroyDescriptorSetLayout(m_Device.m_LogicalDevice, m_DescriptorSetLayout, &m_Allocator);
 
 	vkDestroyPipeline(m_Device.m_LogicalDevice, m_Handle, &m_Allocator);
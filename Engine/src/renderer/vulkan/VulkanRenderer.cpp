@@ -10,6 +10,7 @@
 
 #include "core/Platform.hpp"
 #include "core/Application.hpp"
+#include "core/Profiler.hpp"
 
 VulkanRenderer::VulkanRenderer(HWND windowHandle, HINSTANCE windowsInstance, unsigned int width, unsigned int height) :
 	m_Instance(),
@@ -53,12 +54,21 @@ VulkanRenderer::VulkanRenderer(HWND windowHandle, HINSTANCE windowsInstance, uns
 }
 
 bool VulkanRenderer::beginFrame() {
-	// Wait for the previous frame to finish
-	vkWaitForFences(m_Device.m_LogicalDevice, 1, &m_Swapchain.m_InFlightFences[m_Swapchain.m_CurrentFrame]->m_Handle, VK_TRUE, UINT64_MAX);
+	EN_PROFILE_FUNCTION();
+	m_Instance.m_HostAllocator.beginFrame();
 
-	if (!m_Swapchain.acquireNextImage(m_Pipeline.m_Renderpass)) {
-		EN_DEBUG("Swapchain recreation. Booting.");
-		return false;
+	{
+		// Wait for the previous frame to finish, time spent here is the GPU running behind
+		EN_PROFILE_SCOPE("Wait for in flight fence");
+		vkWaitForFences(m_Device.m_LogicalDevice, 1, &m_Swapchain.m_InFlightFences[m_Swapchain.m_CurrentFrame]->m_Handle, VK_TRUE, UINT64_MAX);
+	}
+
+	{
+		EN_PROFILE_SCOPE("Acquire swapchain image");
+		if (!m_Swapchain.acquireNextImage(m_Pipeline.m_Renderpass)) {
+			EN_DEBUG("Swapchain recreation. Booting.");
+			return false;
+		}
 	}
 
 	vkResetFences(m_Device.m_LogicalDevice, 1, &m_Swapchain.m_InFlightFences[m_Swapchain.m_CurrentFrame]->m_Handle);
@@ -75,6 +85,7 @@ bool VulkanRenderer::beginFrame() {
 }
 
 bool VulkanRenderer::drawFrame() {
+	EN_PROFILE_FUNCTION();
 	// Maybe this does belong somewhere else
 	m_UniformBuffer.update(m_Swapchain.m_Width, m_Swapchain.m_Height, m_Swapchain.m_CurrentFrame);
 
@@ -119,7 +130,7 @@ bool VulkanRenderer::drawFrame() {
 		0,
 		nullptr);
 	vkCmdDrawIndexed(m_CommandBuffers[m_Swapchain.m_CurrentFrame]->m_Handle,
-					 static_cast<uint32_t>(m_IndexBuffer.m_Indices->size()),
+					 static_cast<uint32_t>(m_IndexBuffer.m_Indices.Size()),
 					 1,
 					 0,
 					 0,
@@ -128,6 +139,7 @@ bool VulkanRenderer::drawFrame() {
 }
 
 bool VulkanRenderer::endFrame() {
+	EN_PROFILE_FUNCTION();
 	if (!m_Pipeline.m_Renderpass.end(m_Swapchain.m_CurrentSwapchainImageIndex,
 									m_CommandBuffers[m_Swapchain.m_CurrentFrame])) {
 		EN_ERROR("Failed to end renderpass.");
@@ -154,10 +166,14 @@ bool VulkanRenderer::endFrame() {
 	submitInfo.signalSemaphoreCount = 1;
 	submitInfo.pSignalSemaphores = signalSemaphores;
 
-	VkResult result = vkQueueSubmit(m_Device.m_GraphicsQueue,
-									1,
-									&submitInfo,
-									m_Swapchain.m_InFlightFences[m_Swapchain.m_CurrentFrame]->m_Handle);
+	VkResult result;
+	{
+		EN_PROFILE_SCOPE("vkQueueSubmit");
+		result = vkQueueSubmit(m_Device.m_GraphicsQueue,
+							   1,
+							   &submitInfo,
+							   m_Swapchain.m_InFlightFences[m_Swapchain.m_CurrentFrame]->m_Handle);
+	}
 	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
 		m_Swapchain.recreate({ m_FramebufferWidth,
 							   m_FramebufferHeight,
@@ -170,7 +186,10 @@ bool VulkanRenderer::endFrame() {
 		EN_ERROR("vkQueueSubmit failed with result: %s.", VulkanResultString(result, true));
 	}
 
-	m_Swapchain.present();
+	{
+		EN_PROFILE_SCOPE("Present");
+		m_Swapchain.present();
+	}
 	m_Swapchain.m_CurrentFrame = (m_Swapchain.m_CurrentFrame + 1) % FRAMES_IN_FLIGHT;
 	return true;
 }
@@ -186,6 +205,10 @@ bool VulkanRenderer::OnResize(const void* sender, EventContext context, EventTyp
 	return true;
 }
 
+void VulkanRenderer::printMemoryStats() const {
+	m_Instance.m_HostAllocator.printStats();
+}
+
 VulkanRenderer::~VulkanRenderer() {
 	// Destroy vulkan objects in the reverse order they were created
 	vkDeviceWaitIdle(m_Device.m_LogicalDevice);
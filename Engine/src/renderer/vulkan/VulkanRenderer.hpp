@@ -22,6 +22,7 @@ public:
 
 	~VulkanRenderer();
 	bool OnResize(const void* sender, EventContext context, EventType type);
+	void printMemoryStats() const;
 
 private:
 	VulkanInstance m_Instance;
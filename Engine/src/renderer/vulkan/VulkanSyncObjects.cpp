@@ -4,6 +4,16 @@
 
 #include "core/Logger.hpp"
 
+PoolAllocator<VulkanSemaphore> VulkanSemaphore::m_Pool("VulkanSemaphore", MEMORY_TAG_RENDERER);
+
+void* VulkanSemaphore::operator new(size_t size) {
+	return m_Pool.AllocateObject(size);
+}
+
+void VulkanSemaphore::operator delete(void* block) {
+	m_Pool.Free(block);
+}
+
 VulkanSemaphore::VulkanSemaphore(const VulkanDevice& device, const VkAllocationCallbacks& allocator)
 	: m_Device(device), m_Allocator(allocator) {
 	VkSemaphoreCreateInfo createInfo{};
@@ -15,6 +25,16 @@ VulkanSemaphore::~VulkanSemaphore() {
 	vkDestroySemaphore(m_Device.m_LogicalDevice, m_Handle, &m_Allocator);
 }
 
+PoolAllocator<VulkanFence> VulkanFence::m_Pool("VulkanFence", MEMORY_TAG_RENDERER);
+
+void* VulkanFence::operator new(size_t size) {
+	return m_Pool.AllocateObject(size);
+}
+
+void VulkanFence::operator delete(void* block) {
+	m_Pool.Free(block);
+}
+
 VulkanFence::VulkanFence(const VulkanDevice& device, const VkAllocationCallbacks& allocator)
 	: m_Device(device), m_Allocator(allocator) {
 	VkFenceCreateInfo createInfo{};
@@ -3,25 +3,38 @@
 #include <vulkan/vulkan.h>
 
 #include "VulkanDevice.hpp"
+#include "core/PoolAllocator.hpp"
 
 class VulkanSemaphore {
 public:
 	VulkanSemaphore(const VulkanDevice& device, const VkAllocationCallbacks& allocator);
 	~VulkanSemaphore();
+
+	// Allocated from a pool instead of the system heap
+	static void* operator new(size_t size);
+	static void operator delete(void* block);
 public:
 	VkSemaphore m_Handle;
 private:
 	const VulkanDevice& m_Device;
 	const VkAllocationCallbacks& m_Allocator;
+
+	static PoolAllocator<VulkanSemaphore> m_Pool;
 };
 
 class VulkanFence {
 public:
 	VulkanFence(const VulkanDevice& device, const VkAllocationCallbacks& allocator);
 	~VulkanFence();
+
+	// Allocated from a pool instead of the system heap
+	static void* operator new(size_t size);
+	static void operator delete(void* block);
 public:
 	VkFence m_Handle;
 private:
 	const VulkanDevice& m_Device;
 	const VkAllocationCallbacks& m_Allocator;
+
+	static PoolAllocator<VulkanFence> m_Pool;
 };
\ No newline at end of file